@@ -2,19 +2,25 @@
 
 
 #include "Enemy.h"
+#include "Runner.h"
 #include "GameFramework/Character.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Components/BoxComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/SkeletalMeshComponent.h"
-
-#define print(text) if (GEngine) GEngine->AddOnScreenDebugMessage(-1, 1.5, FColor::White,text)
+#include "EnemyArchetype.h"
+#include "EnemyManagerSubsystem.h"
+#include "ProjectilePoolSubsystem.h"
+#include "RagdollBudgetSubsystem.h"
+#include "RunnerVisualState.h"
+#include "RunnerFrameBudgetSubsystem.h"
+#include "RunnerTelemetrySubsystem.h"
 
 // Sets default values
 AEnemy::AEnemy()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+ 	// Targeting and firing are driven by UEnemyManagerSubsystem, so enemies never tick on their own
+	PrimaryActorTick.bCanEverTick = false;
 	CapsuleComponent = CreateDefaultSubobject<UCapsuleComponent>(FName("Capsule"));
 	RootComponent = CapsuleComponent;
 	MeshComponent = CreateDefaultSubobject<USkeletalMeshComponent>(FName("Mesh"));
@@ -30,22 +36,40 @@ AEnemy::AEnemy()
 	//Setup weapon skeletal mesh
 	GunMeshComponent = CreateDefaultSubobject<USkeletalMeshComponent>(FName("Gun"));
 	GunMeshComponent->SetupAttachment(MeshComponent);
+
+	// Let the engine skip animation frames on distant enemies
+	MeshComponent->bEnableUpdateRateOptimizations = true;
+	GunMeshComponent->bEnableUpdateRateOptimizations = true;
 }
 
 void AEnemy::Start()
 {
 	isDead = false;
 	Target = nullptr;
+	if (URagdollBudgetSubsystem* RagdollBudget = GetWorld()->GetSubsystem<URagdollBudgetSubsystem>())
+	{
+		RagdollBudget->RemoveRagdoll(this);
+	}
+	MeshComponent->bPauseAnims = false;
+	MeshComponent->SetComponentTickEnabled(true);
+	MeshComponent->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
 	MeshComponent->AttachToComponent(CapsuleComponent, FAttachmentTransformRules(EAttachmentRule::KeepRelative, EAttachmentRule::KeepRelative, EAttachmentRule::KeepRelative, true));
 	MeshComponent->SetSimulatePhysics(false);
 	MeshComponent->SetRelativeLocationAndRotation(DefaultLocation, DefaultRotation, false, nullptr, ETeleportType::ResetPhysics);
 	CapsuleComponent->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Block);
 	CapsuleComponent->SetCollisionResponseToChannel(ECollisionChannel::ECC_Visibility, ECollisionResponse::ECR_Ignore);
 	CapsuleComponent->SetRelativeRotation(FRotator(0.0f, 0.0f, 0.0f));
-	if (Type != EEnemyTypes::Stand)
+	FRunnerVisualState::Reset(MeshComponent);
+	const FEnemyArchetype* EnemyArchetype = GetArchetype();
+	const EEnemyArchetypeFlags Flags = EnemyArchetype ? EnemyArchetype->Flags : FEnemyArchetype::GetFlagsForType(Type);
+	if (EnumHasAnyFlags(Flags, EEnemyArchetypeFlags::StartCrouched))
 	{
 		Crouch();
 	}
+	if (UEnemyManagerSubsystem* EnemyManager = GetWorld()->GetSubsystem<UEnemyManagerSubsystem>())
+	{
+		EnemyManager->ResetEnemy(this);
+	}
 }
 
 void AEnemy::Crouch()
@@ -67,6 +91,12 @@ void AEnemy::Uncrouch()
 	//CapsuleComponent->SetRelativeLocationAndRotation(FVector(DefaultLocation.X, DefaultLocation.Y, DefaultLocation.Z), DefaultRotation.Quaternion(), false, nullptr, ETeleportType::TeleportPhysics);
 	CapsuleComponent->MoveComponent(FVector(0.0f, 0.0f, defaultHeight / 2.0f), CapsuleComponent->GetComponentRotation(), false, nullptr, EMoveComponentFlags::MOVECOMP_NoFlags, ETeleportType::TeleportPhysics);
 	MeshComponent->SetRelativeLocationAndRotation(DefaultLocation, DefaultRotation, false, nullptr, ETeleportType::ResetPhysics);
+
+	// The detection boxes rose with the capsule
+	if (UEnemyManagerSubsystem* EnemyManager = GetWorld()->GetSubsystem<UEnemyManagerSubsystem>())
+	{
+		EnemyManager->RefreshDetectionVolumes(this);
+	}
 }
 
 // Called when the game starts or when spawned
@@ -76,10 +106,17 @@ void AEnemy::BeginPlay()
 	defaultHeight = CapsuleComponent->GetScaledCapsuleHalfHeight();
 	DefaultLocation = MeshComponent->GetRelativeLocation();
 	DefaultRotation = MeshComponent->GetRelativeRotation();
-	print(FString::Printf(TEXT("Default location is (%f, %f, %f)"), DefaultLocation.X, DefaultLocation.Y, DefaultLocation.Z));
-	print(FString::Printf(TEXT("Default rotation is (%f, %f, %f)"), DefaultRotation.Roll, DefaultRotation.Pitch, DefaultRotation.Yaw));
+	DefaultAnimTickOption = MeshComponent->VisibilityBasedAnimTickOption;
+	UE_LOG(LogRunner, Verbose, TEXT("%s default mesh location is %s, rotation is %s"), *GetName(), *DefaultLocation.ToString(), *DefaultRotation.ToString());
 	
-	GunMeshComponent->AttachToComponent(MeshComponent, FAttachmentTransformRules::SnapToTargetIncludingScale, WeaponSocketName);
+	// Registering bakes the archetype, which everything below reads from
+	if (UEnemyManagerSubsystem* EnemyManager = GetWorld()->GetSubsystem<UEnemyManagerSubsystem>())
+	{
+		EnemyManager->RegisterEnemy(this);
+	}
+	const FEnemyArchetype* EnemyArchetype = GetArchetype();
+
+	GunMeshComponent->AttachToComponent(MeshComponent, FAttachmentTransformRules::SnapToTargetIncludingScale, EnemyArchetype ? EnemyArchetype->WeaponSocketName : WeaponSocketName);
 	//GunMeshComponent->AttachTo(MeshComponent, WeaponSocketName, EAttachLocation::SnapToTarget, false);
 	//CapsuleComponent->OnComponentHit.AddDynamic(this, &AEnemy::OnCapsuleHit);
 
@@ -91,83 +128,198 @@ void AEnemy::BeginPlay()
 	Start();
 }
 
-void AEnemy::RotateTowardsTarget()
+void AEnemy::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	if (Target == nullptr)
+	if (UEnemyManagerSubsystem* EnemyManager = GetWorld()->GetSubsystem<UEnemyManagerSubsystem>())
 	{
-		return;
+		EnemyManager->UnregisterEnemy(this);
+	}
+	if (URagdollBudgetSubsystem* RagdollBudget = GetWorld()->GetSubsystem<URagdollBudgetSubsystem>())
+	{
+		RagdollBudget->RemoveRagdoll(this);
 	}
-	SetActorRotation(FRotator(0.0f, UKismetMathLibrary::FindLookAtRotation(GetActorLocation(), Target->GetActorLocation()).Yaw, 0.0f));
+	Super::EndPlay(EndPlayReason);
 }
 
-void AEnemy::Fire()
+void AEnemy::RotateTowardsTarget(float TargetYaw)
 {
+	SCOPE_CYCLE_COUNTER(STAT_RunnerEnemyRotate);
+	SetActorRotation(FRotator(0.0f, TargetYaw, 0.0f));
+}
+
+void AEnemy::Fire(const FEnemyArchetype& EnemyArchetype, const FVector& Muzzle, const FVector& AimPoint)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RunnerEnemyFire);
 	if (Target == nullptr)
 	{
 		return;
 	}
-	float currentTime = GetGameTimeSinceCreation();
-	if (currentTime - lastFired < fireRate)
+	UProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>();
+	if (ProjectilePool == nullptr)
 	{
 		return;
 	}
-	FVector muzzleLoc = GunMeshComponent->GetSocketLocation(MuzzleSocketName);
-	FVector targetLoc = Target->GetActorLocation();
-	FActorSpawnParameters SpawnParams;
-	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-	GetWorld()->SpawnActor<AActor>(Projectile, muzzleLoc, UKismetMathLibrary::FindLookAtRotation(muzzleLoc, targetLoc), SpawnParams);
-	lastFired = currentTime;
+	ProjectilePool->Acquire(EnemyArchetype.Projectile, Muzzle, UKismetMathLibrary::FindLookAtRotation(Muzzle, AimPoint), this);
 }
 
-void AEnemy::OnEnemyHit(AActor* SelfActor, AActor* OtherActor, FVector NormalImpulse, const FHitResult& Hit)
+const FEnemyArchetype* AEnemy::GetArchetype() const
+{
+	UEnemyManagerSubsystem* EnemyManager = GetWorld()->GetSubsystem<UEnemyManagerSubsystem>();
+	return EnemyManager ? EnemyManager->GetArchetype(this) : nullptr;
+}
+
+void AEnemy::ApplySignificance(EEnemySignificance Significance, float ReducedTickInterval)
+{
+	switch (Significance)
+	{
+	case EEnemySignificance::Full:
+		MeshComponent->SetComponentTickEnabled(true);
+		MeshComponent->SetComponentTickInterval(0.0f);
+		MeshComponent->VisibilityBasedAnimTickOption = DefaultAnimTickOption;
+		GunMeshComponent->SetComponentTickEnabled(true);
+		GunMeshComponent->SetComponentTickInterval(0.0f);
+		break;
+	case EEnemySignificance::Reduced:
+		MeshComponent->SetComponentTickEnabled(true);
+		MeshComponent->SetComponentTickInterval(ReducedTickInterval);
+		MeshComponent->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered;
+		GunMeshComponent->SetComponentTickEnabled(true);
+		GunMeshComponent->SetComponentTickInterval(ReducedTickInterval);
+		break;
+	case EEnemySignificance::Dormant:
+		MeshComponent->SetComponentTickEnabled(false);
+		GunMeshComponent->SetComponentTickEnabled(false);
+		break;
+	}
+}
+
+void AEnemy::StartRagdoll()
 {
-	print(FString::Printf(TEXT("Hit occured!")));
 	MeshComponent->SetSimulatePhysics(true);
-	Target = nullptr;
-	isDead = true;
-	CapsuleComponent->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-	/*if (OtherActor->IsA(Projectile))
+}
+
+void AEnemy::FreezeRagdoll()
+{
+	// With the mesh no longer ticking the last simulated pose stays on screen for free
+	MeshComponent->SetSimulatePhysics(false);
+	MeshComponent->bPauseAnims = true;
+	MeshComponent->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	MeshComponent->SetComponentTickEnabled(false);
+}
+
+void AEnemy::Retire()
+{
+	FreezeRagdoll();
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+}
+
+float AEnemy::GetRagdollSpeed() const
+{
+	return MeshComponent->GetPhysicsLinearVelocity().Size();
+}
+
+void AEnemy::SetTarget(AActor* NewTarget)
+{
+	Target = NewTarget;
+	if (UEnemyManagerSubsystem* EnemyManager = GetWorld()->GetSubsystem<UEnemyManagerSubsystem>())
 	{
-		
-	}*/
+		EnemyManager->SetTarget(this, NewTarget);
+	}
 }
 
-void AEnemy::OnEnemyDetected(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+void AEnemy::OnEnemyHit(AActor* SelfActor, AActor* OtherActor, FVector NormalImpulse, const FHitResult& Hit)
 {
+	HandleProjectileHit(OtherActor);
+}
+
+void AEnemy::HandleProjectileHit(AActor* Projectile)
+{
+	// The ragdoll keeps generating hits, only the first one kills
 	if (isDead)
 	{
 		return;
 	}
+	UE_LOG(LogRunner, Verbose, TEXT("%s was hit by %s"), *GetName(), *GetNameSafe(Projectile));
+	URunnerTelemetrySubsystem::RecordEvent(this, ERunnerTelemetryEvent::EnemyKilled);
+	SetTarget(nullptr);
+	isDead = true;
+	if (UEnemyManagerSubsystem* EnemyManager = GetWorld()->GetSubsystem<UEnemyManagerSubsystem>())
+	{
+		EnemyManager->SetAlive(this, false);
+	}
+
+	// Switching to physics is the expensive part of dying, several kills in one frame are spread out
+	URunnerFrameBudgetSubsystem::Defer(this, ERunnerWorkPriority::High, [this]()
+	{
+		// Start() may have re-armed the enemy before this ran
+		if (!isDead)
+		{
+			return;
+		}
+		if (URagdollBudgetSubsystem* RagdollBudget = GetWorld()->GetSubsystem<URagdollBudgetSubsystem>())
+		{
+			RagdollBudget->AddRagdoll(this);
+		}
+		else
+		{
+			StartRagdoll();
+		}
+		CapsuleComponent->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
+	});
+}
+
+void AEnemy::UseTrackCollision()
+{
+	OnActorHit.RemoveDynamic(this, &AEnemy::OnEnemyHit);
+}
+
+UPrimitiveComponent* AEnemy::GetHitVolume() const
+{
+	return CapsuleComponent;
+}
+
+void AEnemy::OnEnemyDetected(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+{
 	ACharacter* characterTemp = Cast<ACharacter>(OtherActor);
 	if (characterTemp == nullptr)
 	{
 		return;
 	}
-	if (Type == EEnemyTypes::Cover)
+	HandleRunnerDetected(OtherActor);
+}
+
+void AEnemy::OnEnterFireRange(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+{
+	ACharacter* characterTemp = Cast<ACharacter>(OtherActor);
+	if (characterTemp == nullptr)
 	{
-		Uncrouch();
+		return;
 	}
+	HandleRunnerInFireRange(OtherActor);
 }
 
-void AEnemy::OnEnterFireRange(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+void AEnemy::HandleRunnerDetected(AActor* Runner)
 {
 	if (isDead)
 	{
 		return;
 	}
-	ACharacter* characterTemp = Cast<ACharacter>(OtherActor);
-	if (characterTemp == nullptr)
+	FRunnerVisualState::Set(MeshComponent, ERunnerVisualState::Alerted, 1.0f);
+	const FEnemyArchetype* EnemyArchetype = GetArchetype();
+	const EEnemyArchetypeFlags Flags = EnemyArchetype ? EnemyArchetype->Flags : FEnemyArchetype::GetFlagsForType(Type);
+	if (EnumHasAnyFlags(Flags, EEnemyArchetypeFlags::UncrouchOnDetect))
 	{
-		return;
+		Uncrouch();
 	}
-	Target = OtherActor;
 }
 
-// Called every frame
-void AEnemy::Tick(float DeltaTime)
+void AEnemy::HandleRunnerInFireRange(AActor* Runner)
 {
-	Super::Tick(DeltaTime);
-	RotateTowardsTarget();
-	Fire();
+	if (isDead)
+	{
+		return;
+	}
+	SetTarget(Runner);
 }
 
@@ -9,6 +9,7 @@
 class USkeletalMeshComponent;
 class UCapsuleComponent;
 class UBoxComponent;
+struct FEnemyArchetype;
 
 UENUM(BlueprintType)
 enum EEnemyTypes
@@ -18,6 +19,14 @@ enum EEnemyTypes
 	Stand	UMETA(DisplayName = "Standing")
 };
 
+/** How much per-frame work an enemy is allowed, assigned by UEnemyManagerSubsystem */
+enum class EEnemySignificance : uint8
+{
+	Full,
+	Reduced,
+	Dormant
+};
+
 UCLASS()
 class RUNNER_API AEnemy : public AActor
 {
@@ -34,6 +43,46 @@ public:
 
 	void Uncrouch();
 
+	/** Turns the enemy to the yaw computed by the enemy manager */
+	void RotateTowardsTarget(float TargetYaw);
+
+	/** Launches a projectile from Muzzle towards AimPoint, the enemy manager decides when and where */
+	void Fire(const FEnemyArchetype& Archetype, const FVector& Muzzle, const FVector& AimPoint);
+
+	void SetTarget(AActor* NewTarget);
+
+	/** Reaction to the runner entering EnemyDetectionRange */
+	void HandleRunnerDetected(AActor* Runner);
+
+	/** Reaction to the runner entering FireRange */
+	void HandleRunnerInFireRange(AActor* Runner);
+
+	/** Lets the body fall under physics, called by URagdollBudgetSubsystem */
+	void StartRagdoll();
+
+	/** Stops simulating and holds the ragdoll in its current pose */
+	void FreezeRagdoll();
+
+	/** Takes a dead enemy out of the scene until its tile is recycled and Start() re-arms it */
+	void Retire();
+
+	/** Linear speed of the ragdoll's root body */
+	float GetRagdollSpeed() const;
+
+	/** Kills the enemy, whatever detected the projectile touching it */
+	void HandleProjectileHit(AActor* Projectile);
+
+	/** Stops listening for actor hits, UTrackCollisionSubsystem reports projectile hits instead */
+	void UseTrackCollision();
+
+	bool IsDead() const { return isDead; }
+
+	/** Shape projectiles are tested against */
+	UPrimitiveComponent* GetHitVolume() const;
+
+	/** Adjusts mesh ticking and animation for the given significance */
+	void ApplySignificance(EEnemySignificance Significance, float ReducedTickInterval);
+
 	AActor* Target;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon")
@@ -52,15 +101,13 @@ public:
 	TEnumAsByte<EEnemyTypes> Type;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon")
-	TSubclassOf<AActor> Projectile;
+	TSoftClassPtr<AActor> Projectile;
 
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-	void RotateTowardsTarget();
-
-	void Fire();
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	UFUNCTION()
 	void OnEnemyHit(AActor* SelfActor, AActor* OtherActor, FVector NormalImpulse, const FHitResult& Hit);
@@ -88,16 +135,19 @@ protected:
 
 	bool isDead;
 
-	float lastFired;
-
 	float defaultHeight;
 
 	FVector DefaultLocation;
 
 	FRotator DefaultRotation;
 
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+	EVisibilityBasedAnimTickOption DefaultAnimTickOption;
+
+	/** Baked archetype from the enemy manager, nullptr before the enemy is registered */
+	const FEnemyArchetype* GetArchetype() const;
+
+	/** Slot in UEnemyManagerSubsystem's arrays */
+	int32 ManagerIndex = INDEX_NONE;
 
+	friend class UEnemyManagerSubsystem;
 };
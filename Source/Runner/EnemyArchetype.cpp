@@ -0,0 +1,148 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemyArchetype.h"
+#include "Runner.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/SkeletalMeshSocket.h"
+#include "RunnerPreloadSubsystem.h"
+
+EEnemyArchetypeFlags FEnemyArchetype::GetFlagsForType(EEnemyTypes Type)
+{
+	switch (Type)
+	{
+	case EEnemyTypes::Cover:
+		return EEnemyArchetypeFlags::StartCrouched | EEnemyArchetypeFlags::UncrouchOnDetect;
+	case EEnemyTypes::Crouch:
+		return EEnemyArchetypeFlags::StartCrouched;
+	default:
+		return EEnemyArchetypeFlags::None;
+	}
+}
+
+FVector FEnemyArchetype::GetMuzzleLocation(const USkeletalMeshComponent* GunMesh) const
+{
+	if (MuzzleBoneIndex == INDEX_NONE)
+	{
+		return GunMesh->GetComponentLocation();
+	}
+	return GunMesh->GetBoneTransform(MuzzleBoneIndex).TransformPosition(MuzzleOffset.GetLocation());
+}
+
+void FEnemyArchetypeTable::Bake(const UDataTable* Table)
+{
+	Reset();
+	if (Table == nullptr)
+	{
+		return;
+	}
+	if (Table->GetRowStruct() == nullptr || !Table->GetRowStruct()->IsChildOf(FEnemyArchetypeRow::StaticStruct()))
+	{
+		UE_LOG(LogRunner, Warning, TEXT("%s does not hold FEnemyArchetypeRow rows"), *Table->GetName());
+		return;
+	}
+	for (const TPair<FName, uint8*>& Row : Table->GetRowMap())
+	{
+		const FEnemyArchetypeRow& RowData = *reinterpret_cast<const FEnemyArchetypeRow*>(Row.Value);
+		if (RowData.EnemyClass.IsNull())
+		{
+			UE_LOG(LogRunner, Warning, TEXT("Enemy archetype %s in %s has no enemy class, skipping it"), *Row.Key.ToString(), *Table->GetName());
+			continue;
+		}
+		if (const FName* Existing = ClassRows.Find(RowData.EnemyClass.ToSoftObjectPath()))
+		{
+			UE_LOG(LogRunner, Warning, TEXT("Enemy archetypes %s and %s in %s both configure %s, keeping %s"), *Existing->ToString(), *Row.Key.ToString(), *Table->GetName(), *RowData.EnemyClass.ToString(), *Existing->ToString());
+			continue;
+		}
+		ClassRows.Add(RowData.EnemyClass.ToSoftObjectPath(), Row.Key);
+		Rows.Add(Row.Key, MakeFromRow(RowData));
+		RowProjectiles.Add(Row.Key, RowData.Projectile.ToSoftObjectPath());
+	}
+	UE_LOG(LogRunner, Log, TEXT("Baked %d enemy archetypes from %s"), Rows.Num(), *Table->GetName());
+}
+
+int32 FEnemyArchetypeTable::FindOrAdd(const AEnemy* Enemy, const USkeletalMeshComponent* GunMesh)
+{
+	const FName RowName = FindRow(Enemy);
+	const FEnemyArchetype* Row = RowName.IsNone() ? nullptr : Rows.Find(RowName);
+
+	// Rows fix the type, so only enemies built from their own properties are split by it
+	const FKey Key(Enemy->GetClass(), GunMesh->GetSkeletalMeshAsset(), RowName, Row ? 0 : uint8(Enemy->Type));
+	if (const int32* Existing = Lookup.Find(Key))
+	{
+		return *Existing;
+	}
+
+	FEnemyArchetype Archetype = Row ? *Row : MakeFromEnemy(Enemy);
+	ResolveSockets(Archetype, GunMesh);
+	Archetype.Projectile = Cast<UClass>(URunnerPreloadSubsystem::Resolve(Row ? RowProjectiles.FindRef(RowName) : Enemy->Projectile.ToSoftObjectPath()));
+	const int32 Index = Archetypes.Add(Archetype);
+	Lookup.Add(Key, Index);
+	return Index;
+}
+
+void FEnemyArchetypeTable::SetLaunchParams(int32 Index, float Speed, float Lifetime)
+{
+	FEnemyArchetype& Archetype = Archetypes[Index];
+	Archetype.ProjectileSpeed = Speed;
+	Archetype.ProjectileLifetime = Lifetime;
+	Archetype.bLaunchResolved = true;
+}
+
+void FEnemyArchetypeTable::Reset()
+{
+	Rows.Reset();
+	RowProjectiles.Reset();
+	ClassRows.Reset();
+	Archetypes.Reset();
+	Lookup.Reset();
+}
+
+FEnemyArchetype FEnemyArchetypeTable::MakeFromRow(const FEnemyArchetypeRow& Row)
+{
+	FEnemyArchetype Archetype;
+	Archetype.FireRate = Row.FireRate;
+	Archetype.Flags = FEnemyArchetype::GetFlagsForType(Row.Type);
+	Archetype.MuzzleSocketName = Row.MuzzleSocketName;
+	Archetype.WeaponSocketName = Row.WeaponSocketName;
+	return Archetype;
+}
+
+FEnemyArchetype FEnemyArchetypeTable::MakeFromEnemy(const AEnemy* Enemy)
+{
+	FEnemyArchetype Archetype;
+	Archetype.FireRate = Enemy->fireRate;
+	Archetype.Flags = FEnemyArchetype::GetFlagsForType(Enemy->Type);
+	Archetype.MuzzleSocketName = Enemy->MuzzleSocketName;
+	Archetype.WeaponSocketName = Enemy->WeaponSocketName;
+	return Archetype;
+}
+
+FName FEnemyArchetypeTable::FindRow(const AEnemy* Enemy) const
+{
+	if (ClassRows.Num() == 0)
+	{
+		return NAME_None;
+	}
+	for (const UClass* Class = Enemy->GetClass(); Class != nullptr && Class->IsChildOf(AEnemy::StaticClass()); Class = Class->GetSuperClass())
+	{
+		if (const FName* RowName = ClassRows.Find(FSoftObjectPath(Class)))
+		{
+			return *RowName;
+		}
+	}
+	return NAME_None;
+}
+
+void FEnemyArchetypeTable::ResolveSockets(FEnemyArchetype& Archetype, const USkeletalMeshComponent* GunMesh)
+{
+	const USkeletalMeshSocket* Socket = GunMesh->GetSocketByName(Archetype.MuzzleSocketName);
+	if (Socket == nullptr)
+	{
+		Archetype.MuzzleBoneIndex = GunMesh->GetBoneIndex(Archetype.MuzzleSocketName);
+		Archetype.MuzzleOffset = FTransform::Identity;
+		return;
+	}
+	Archetype.MuzzleBoneIndex = GunMesh->GetBoneIndex(Socket->BoneName);
+	Archetype.MuzzleOffset = Socket->GetSocketLocalTransform();
+}
@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataTable.h"
+#include "Enemy.h"
+#include "EnemyArchetype.generated.h"
+
+class USkeletalMeshComponent;
+
+/** One enemy variant as designers author it in the enemy archetype DataTable */
+USTRUCT(BlueprintType)
+struct FEnemyArchetypeRow : public FTableRowBase
+{
+	GENERATED_BODY()
+
+	/** Enemy class this row configures, subclasses included unless they have a row of their own */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Enemy")
+	TSoftClassPtr<AEnemy> EnemyClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Enemy")
+	TEnumAsByte<EEnemyTypes> Type = EEnemyTypes::Stand;
+
+	/** Seconds between shots */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Weapon")
+	float FireRate = 1.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Weapon")
+	TSoftClassPtr<AActor> Projectile;
+
+	/** Socket on the gun mesh projectiles leave from */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Weapon")
+	FName MuzzleSocketName;
+
+	/** Socket on the body mesh the gun is attached to */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Weapon")
+	FName WeaponSocketName;
+};
+
+/** Behaviour baked from EEnemyTypes so enemies test bits instead of branching on their type */
+enum class EEnemyArchetypeFlags : uint8
+{
+	None = 0,
+	StartCrouched = 1 << 0,
+	UncrouchOnDetect = 1 << 1
+};
+ENUM_CLASS_FLAGS(EEnemyArchetypeFlags);
+
+/** Runtime form of an archetype with its muzzle socket resolved to a bone index */
+struct FEnemyArchetype
+{
+	/** Resolved when the archetype is first used, kept alive by UEnemyManagerSubsystem */
+	UClass* Projectile = nullptr;
+
+	float FireRate = 1.0f;
+
+	EEnemyArchetypeFlags Flags = EEnemyArchetypeFlags::None;
+
+	/** Launch speed of Projectile, zero when it has no projectile movement */
+	float ProjectileSpeed = 0.0f;
+
+	/** Seconds Projectile stays in flight, intercepts later than this are not worth a shot */
+	float ProjectileLifetime = 0.0f;
+
+	bool bLaunchResolved = false;
+
+	/** Bone the muzzle socket hangs off, INDEX_NONE when the gun mesh has no such socket */
+	int32 MuzzleBoneIndex = INDEX_NONE;
+
+	/** Muzzle socket relative to MuzzleBoneIndex */
+	FTransform MuzzleOffset;
+
+	FName MuzzleSocketName;
+
+	/** Only needed once, when the gun is attached in BeginPlay */
+	FName WeaponSocketName;
+
+	static EEnemyArchetypeFlags GetFlagsForType(EEnemyTypes Type);
+
+	/** World-space muzzle location on the given gun mesh */
+	FVector GetMuzzleLocation(const USkeletalMeshComponent* GunMesh) const;
+};
+
+/**
+ * Flat table of baked enemy archetypes. Rows come from a DataTable and apply to every enemy of the
+ * row's class, so enemies carry nothing but the index; enemies whose class has no row get an
+ * archetype built from their own weapon properties so existing Blueprints keep working.
+ * Entries are shared by every enemy using the same row, class and gun mesh.
+ */
+class RUNNER_API FEnemyArchetypeTable
+{
+public:
+	/** Converts every row of the DataTable, replacing whatever was baked before */
+	void Bake(const UDataTable* Table);
+
+	/** Index of the archetype the enemy should use, baking and resolving it on first use */
+	int32 FindOrAdd(const AEnemy* Enemy, const USkeletalMeshComponent* GunMesh);
+
+	const FEnemyArchetype& Get(int32 Index) const { return Archetypes[Index]; }
+
+	/** Fills in the projectile's flight parameters once the projectile pool knows them */
+	void SetLaunchParams(int32 Index, float Speed, float Lifetime);
+
+	int32 Num() const { return Archetypes.Num(); }
+
+	void Reset();
+
+private:
+	/** Enemy class, gun mesh asset, row name and type */
+	typedef TTuple<const UClass*, const UObject*, FName, uint8> FKey;
+
+	static FEnemyArchetype MakeFromRow(const FEnemyArchetypeRow& Row);
+
+	static FEnemyArchetype MakeFromEnemy(const AEnemy* Enemy);
+
+	static void ResolveSockets(FEnemyArchetype& Archetype, const USkeletalMeshComponent* GunMesh);
+
+	/** Row of the nearest class in the enemy's hierarchy that has one, None when none does */
+	FName FindRow(const AEnemy* Enemy) const;
+
+	/** Unresolved archetypes by row name, as baked from the DataTable */
+	TMap<FName, FEnemyArchetype> Rows;
+
+	/** Projectile of each row, only loaded once an enemy uses the row */
+	TMap<FName, FSoftObjectPath> RowProjectiles;
+
+	/** Row name by enemy class path, so rows match without loading their classes */
+	TMap<FSoftObjectPath, FName> ClassRows;
+
+	TArray<FEnemyArchetype> Archetypes;
+
+	TMap<FKey, int32> Lookup;
+};
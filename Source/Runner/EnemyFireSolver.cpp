@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemyFireSolver.h"
+
+void FEnemyFireSolver::Reset()
+{
+	NumShots = 0;
+	OriginX.Reset();
+	OriginY.Reset();
+	OriginZ.Reset();
+	OffsetX.Reset();
+	OffsetY.Reset();
+	OffsetZ.Reset();
+	VelocityX.Reset();
+	VelocityY.Reset();
+	VelocityZ.Reset();
+	Speeds.Reset();
+	MaxTimes.Reset();
+	InterceptTimes.Reset();
+}
+
+int32 FEnemyFireSolver::Add(const FVector& Origin, const FVector& TargetLocation, const FVector& TargetVelocity, float ProjectileSpeed, float MaxTime)
+{
+	const FVector Offset = TargetLocation - Origin;
+	OriginX.Add(Origin.X);
+	OriginY.Add(Origin.Y);
+	OriginZ.Add(Origin.Z);
+	OffsetX.Add(Offset.X);
+	OffsetY.Add(Offset.Y);
+	OffsetZ.Add(Offset.Z);
+	VelocityX.Add(TargetVelocity.X);
+	VelocityY.Add(TargetVelocity.Y);
+	VelocityZ.Add(TargetVelocity.Z);
+	Speeds.Add(ProjectileSpeed);
+	MaxTimes.Add(MaxTime);
+	InterceptTimes.Add(-1.0f);
+	return NumShots++;
+}
+
+void FEnemyFireSolver::Solve()
+{
+	// Padding lanes get a zero time limit so they never produce a solution
+	const int32 NumPadded = Align(NumShots, 4);
+	for (FLaneArray* Lane : { &OriginX, &OriginY, &OriginZ, &OffsetX, &OffsetY, &OffsetZ, &VelocityX, &VelocityY, &VelocityZ, &Speeds, &MaxTimes, &InterceptTimes })
+	{
+		Lane->SetNumZeroed(NumPadded);
+	}
+
+	const VectorRegister4Float Zero = VectorZeroFloat();
+	const VectorRegister4Float One = VectorOneFloat();
+	const VectorRegister4Float Two = VectorSetFloat1(2.0f);
+	const VectorRegister4Float Four = VectorSetFloat1(4.0f);
+	const VectorRegister4Float NoSolution = VectorSetFloat1(-1.0f);
+	const VectorRegister4Float Epsilon = VectorSetFloat1(KINDA_SMALL_NUMBER);
+
+	for (int32 Base = 0; Base < NumPadded; Base += 4)
+	{
+		const VectorRegister4Float DX = VectorLoadAligned(&OffsetX[Base]);
+		const VectorRegister4Float DY = VectorLoadAligned(&OffsetY[Base]);
+		const VectorRegister4Float DZ = VectorLoadAligned(&OffsetZ[Base]);
+		const VectorRegister4Float VX = VectorLoadAligned(&VelocityX[Base]);
+		const VectorRegister4Float VY = VectorLoadAligned(&VelocityY[Base]);
+		const VectorRegister4Float VZ = VectorLoadAligned(&VelocityZ[Base]);
+		const VectorRegister4Float S = VectorLoadAligned(&Speeds[Base]);
+		const VectorRegister4Float MaxT = VectorLoadAligned(&MaxTimes[Base]);
+
+		// |D + V t| = S t  =>  (V.V - S^2) t^2 + 2 (D.V) t + D.D = 0
+		const VectorRegister4Float VV = VectorMultiplyAdd(VX, VX, VectorMultiplyAdd(VY, VY, VectorMultiply(VZ, VZ)));
+		const VectorRegister4Float DV = VectorMultiplyAdd(DX, VX, VectorMultiplyAdd(DY, VY, VectorMultiply(DZ, VZ)));
+		const VectorRegister4Float DD = VectorMultiplyAdd(DX, DX, VectorMultiplyAdd(DY, DY, VectorMultiply(DZ, DZ)));
+		const VectorRegister4Float A = VectorSubtract(VV, VectorMultiply(S, S));
+		const VectorRegister4Float B = VectorMultiply(Two, DV);
+		const VectorRegister4Float C = DD;
+
+		// Target as fast as the projectile: the equation is linear, t = -C / B
+		const VectorRegister4Float IsLinear = VectorCompareLT(VectorAbs(A), Epsilon);
+		const VectorRegister4Float SafeB = VectorSelect(VectorCompareLT(VectorAbs(B), Epsilon), One, B);
+		const VectorRegister4Float LinearT = VectorSelect(VectorCompareLT(B, Zero), VectorDivide(VectorNegate(C), SafeB), NoSolution);
+
+		// Otherwise take the smallest positive root
+		const VectorRegister4Float Discriminant = VectorSubtract(VectorMultiply(B, B), VectorMultiply(Four, VectorMultiply(A, C)));
+		const VectorRegister4Float Root = VectorSqrt(VectorMax(Discriminant, Zero));
+		const VectorRegister4Float InvTwoA = VectorDivide(One, VectorMultiply(Two, VectorSelect(IsLinear, One, A)));
+		const VectorRegister4Float T0 = VectorMultiply(VectorSubtract(VectorNegate(B), Root), InvTwoA);
+		const VectorRegister4Float T1 = VectorMultiply(VectorAdd(VectorNegate(B), Root), InvTwoA);
+		const VectorRegister4Float Near = VectorMin(T0, T1);
+		const VectorRegister4Float Far = VectorMax(T0, T1);
+		const VectorRegister4Float QuadraticT = VectorSelect(VectorCompareGE(Discriminant, Zero), VectorSelect(VectorCompareGT(Near, Zero), Near, Far), NoSolution);
+
+		const VectorRegister4Float T = VectorSelect(IsLinear, LinearT, QuadraticT);
+		const VectorRegister4Float InRange = VectorBitwiseAnd(VectorCompareGT(T, Zero), VectorCompareLE(T, MaxT));
+		VectorStoreAligned(VectorSelect(InRange, T, NoSolution), &InterceptTimes[Base]);
+	}
+}
+
+FVector FEnemyFireSolver::GetAimPoint(int32 Index) const
+{
+	const float T = InterceptTimes[Index];
+	return FVector(
+		OriginX[Index] + OffsetX[Index] + VelocityX[Index] * T,
+		OriginY[Index] + OffsetY[Index] + VelocityY[Index] * T,
+		OriginZ[Index] + OffsetZ[Index] + VelocityZ[Index] * T);
+}
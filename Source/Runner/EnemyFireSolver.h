@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Solves where to shoot so a straight-flying projectile meets a target moving at constant velocity.
+ * Shots are queued with Add and solved together four at a time, so the arrays are kept in SoA
+ * form and padded to a multiple of four.
+ */
+class RUNNER_API FEnemyFireSolver
+{
+public:
+	void Reset();
+
+	/** Queues one shot and returns its index for the getters below */
+	int32 Add(const FVector& Origin, const FVector& TargetLocation, const FVector& TargetVelocity, float ProjectileSpeed, float MaxTime);
+
+	/** Computes the earliest intercept of every queued shot */
+	void Solve();
+
+	int32 Num() const { return NumShots; }
+
+	/** False when the projectile cannot reach the target within MaxTime */
+	bool HasSolution(int32 Index) const { return InterceptTimes[Index] >= 0.0f; }
+
+	/** Where the target will be when the projectile gets there */
+	FVector GetAimPoint(int32 Index) const;
+
+	FVector GetOrigin(int32 Index) const { return FVector(OriginX[Index], OriginY[Index], OriginZ[Index]); }
+
+private:
+	typedef TArray<float, TAlignedHeapAllocator<16>> FLaneArray;
+
+	int32 NumShots = 0;
+
+	FLaneArray OriginX;
+	FLaneArray OriginY;
+	FLaneArray OriginZ;
+
+	/** Target location relative to the origin */
+	FLaneArray OffsetX;
+	FLaneArray OffsetY;
+	FLaneArray OffsetZ;
+
+	FLaneArray VelocityX;
+	FLaneArray VelocityY;
+	FLaneArray VelocityZ;
+
+	FLaneArray Speeds;
+
+	FLaneArray MaxTimes;
+
+	/** Seconds until impact, negative when there is no solution */
+	FLaneArray InterceptTimes;
+};
@@ -0,0 +1,459 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemyManagerSubsystem.h"
+#include "Runner.h"
+#include "Components/BoxComponent.h"
+#include "Engine/DataTable.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "Kismet/GameplayStatics.h"
+#include "ProjectilePoolSubsystem.h"
+#include "RunnerCrowdSubsystem.h"
+#include "RunnerSimulationSubsystem.h"
+
+void UEnemyManagerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	DetectionHash.SetCellSize(DetectionCellSize);
+
+	LoadedArchetypeTable = nullptr;
+	if (!ArchetypeTable.IsNull())
+	{
+		LoadedArchetypeTable = Cast<UDataTable>(ArchetypeTable.TryLoad());
+		if (LoadedArchetypeTable == nullptr)
+		{
+			UE_LOG(LogRunner, Warning, TEXT("Could not load enemy archetype table %s"), *ArchetypeTable.ToString());
+		}
+	}
+	Archetypes.Bake(LoadedArchetypeTable);
+}
+
+void UEnemyManagerSubsystem::RegisterEnemy(AEnemy* Enemy)
+{
+	if (Enemy == nullptr || Enemy->ManagerIndex != INDEX_NONE)
+	{
+		return;
+	}
+	Enemy->ManagerIndex = Enemies.Add(Enemy);
+	Targets.Add(nullptr);
+	Positions.Add(Enemy->GetActorLocation());
+	Yaws.Add(Enemy->GetActorRotation().Yaw);
+	LastFired.Add(GetGameplayTime());
+	const int32 ArchetypeIndex = Archetypes.FindOrAdd(Enemy, Enemy->GunMeshComponent);
+	if (!Archetypes.Get(ArchetypeIndex).bLaunchResolved)
+	{
+		if (Archetypes.Get(ArchetypeIndex).Projectile != nullptr)
+		{
+			ArchetypeProjectiles.AddUnique(Archetypes.Get(ArchetypeIndex).Projectile);
+		}
+		// Also warms the projectile ring so the first shot does not spawn
+		float Speed = 0.0f;
+		float Lifetime = 0.0f;
+		if (UProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>())
+		{
+			ProjectilePool->GetLaunchParams(Archetypes.Get(ArchetypeIndex).Projectile, Speed, Lifetime);
+		}
+		Archetypes.SetLaunchParams(ArchetypeIndex, Speed, Lifetime);
+	}
+	ArchetypeIndices.Add(ArchetypeIndex);
+	FireRates.Add(Archetypes.Get(ArchetypeIndex).FireRate);
+	Alive.Add(true);
+	Significances.Add(EEnemySignificance::Full);
+	EngagedSlots.Add(INDEX_NONE);
+	DetectionVolumes.AddDefaulted();
+
+	if (bUseSpatialDetection)
+	{
+		Enemy->FireRange->SetGenerateOverlapEvents(false);
+		Enemy->FireRange->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		Enemy->EnemyDetectionRange->SetGenerateOverlapEvents(false);
+		Enemy->EnemyDetectionRange->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		InsertDetectionVolumes(Enemy->ManagerIndex);
+	}
+}
+
+void UEnemyManagerSubsystem::UnregisterEnemy(AEnemy* Enemy)
+{
+	if (Enemy == nullptr)
+	{
+		return;
+	}
+	const int32 Index = Enemy->ManagerIndex;
+	if (!Enemies.IsValidIndex(Index) || Enemies[Index] != Enemy)
+	{
+		return;
+	}
+	Targets[Index] = nullptr;
+	UpdateEngagement(Index);
+	if (bUseSpatialDetection)
+	{
+		RemoveDetectionVolumes(Index);
+		OccupiedEnemies.RemoveSwap(Enemy, false);
+	}
+
+	Enemies.RemoveAtSwap(Index, 1, false);
+	Targets.RemoveAtSwap(Index, 1, false);
+	Positions.RemoveAtSwap(Index, 1, false);
+	Yaws.RemoveAtSwap(Index, 1, false);
+	LastFired.RemoveAtSwap(Index, 1, false);
+	FireRates.RemoveAtSwap(Index, 1, false);
+	ArchetypeIndices.RemoveAtSwap(Index, 1, false);
+	Alive.RemoveAtSwap(Index, 1, false);
+	Significances.RemoveAtSwap(Index, 1, false);
+	EngagedSlots.RemoveAtSwap(Index, 1, false);
+	DetectionVolumes.RemoveAtSwap(Index, 1, false);
+
+	// The last enemy was moved into the freed slot
+	if (Enemies.IsValidIndex(Index))
+	{
+		Enemies[Index]->ManagerIndex = Index;
+		if (EngagedSlots[Index] != INDEX_NONE)
+		{
+			EngagedIndices[EngagedSlots[Index]] = Index;
+		}
+	}
+	Enemy->ManagerIndex = INDEX_NONE;
+}
+
+void UEnemyManagerSubsystem::ResetEnemy(AEnemy* Enemy)
+{
+	const int32 Index = Enemy->ManagerIndex;
+	if (!Enemies.IsValidIndex(Index))
+	{
+		return;
+	}
+	Targets[Index] = nullptr;
+	Positions[Index] = Enemy->GetActorLocation();
+	Yaws[Index] = Enemy->GetActorRotation().Yaw;
+	LastFired[Index] = GetGameplayTime();
+	FireRates[Index] = Archetypes.Get(ArchetypeIndices[Index]).FireRate;
+	Alive[Index] = true;
+	Significances[Index] = EEnemySignificance::Full;
+	Enemy->ApplySignificance(EEnemySignificance::Full, ReducedTickInterval);
+	UpdateEngagement(Index);
+
+	// The enemy may have been moved along with a recycled tile
+	if (bUseSpatialDetection)
+	{
+		RemoveDetectionVolumes(Index);
+		InsertDetectionVolumes(Index);
+	}
+}
+
+void UEnemyManagerSubsystem::RefreshDetectionVolumes(AEnemy* Enemy)
+{
+	const int32 Index = Enemy->ManagerIndex;
+	if (!bUseSpatialDetection || !Enemies.IsValidIndex(Index))
+	{
+		return;
+	}
+	const bool bRunnerInDetection = DetectionVolumes[Index].bRunnerInDetection;
+	const bool bRunnerInFireRange = DetectionVolumes[Index].bRunnerInFireRange;
+	RemoveDetectionVolumes(Index);
+	InsertDetectionVolumes(Index);
+	DetectionVolumes[Index].bRunnerInDetection = bRunnerInDetection;
+	DetectionVolumes[Index].bRunnerInFireRange = bRunnerInFireRange;
+}
+
+const FEnemyArchetype* UEnemyManagerSubsystem::GetArchetype(const AEnemy* Enemy) const
+{
+	const int32 Index = Enemy->ManagerIndex;
+	return Enemies.IsValidIndex(Index) ? &Archetypes.Get(ArchetypeIndices[Index]) : nullptr;
+}
+
+void UEnemyManagerSubsystem::SetTarget(AEnemy* Enemy, AActor* NewTarget)
+{
+	const int32 Index = Enemy->ManagerIndex;
+	if (!Enemies.IsValidIndex(Index))
+	{
+		return;
+	}
+	Targets[Index] = NewTarget;
+	UpdateEngagement(Index);
+}
+
+void UEnemyManagerSubsystem::SetAlive(AEnemy* Enemy, bool bAlive)
+{
+	const int32 Index = Enemy->ManagerIndex;
+	if (!Enemies.IsValidIndex(Index))
+	{
+		return;
+	}
+	Alive[Index] = bAlive;
+	UpdateEngagement(Index);
+}
+
+float UEnemyManagerSubsystem::GetGameplayTime() const
+{
+	const URunnerSimulationSubsystem* Simulation = GetWorld()->GetSubsystem<URunnerSimulationSubsystem>();
+	return Simulation ? Simulation->GetGameplayTime() : GetWorld()->GetTimeSeconds();
+}
+
+void UEnemyManagerSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	const URunnerSimulationSubsystem* Simulation = GetWorld()->GetSubsystem<URunnerSimulationSubsystem>();
+	if (Simulation == nullptr || !Simulation->IsFixedStep())
+	{
+		StepEnemies(GetWorld()->GetTimeSeconds());
+	}
+	UpdateSignificance(GetWorld()->GetTimeSeconds());
+}
+
+void UEnemyManagerSubsystem::StepEnemies(float Now)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RunnerEnemyTick);
+	FireSolver.Reset();
+	FiringIndices.Reset();
+	const URunnerCrowdSubsystem* Crowd = GetWorld()->GetSubsystem<URunnerCrowdSubsystem>();
+	if (Crowd != nullptr && Crowd->GetNumRunners() == 0)
+	{
+		Crowd = nullptr;
+	}
+
+	// Walk backwards so enemies whose target went away can drop out of the list in place
+	for (int32 Slot = EngagedIndices.Num() - 1; Slot >= 0; Slot--)
+	{
+		const int32 Index = EngagedIndices[Slot];
+		AActor* Target = Targets[Index];
+		if (!IsValid(Target))
+		{
+			Targets[Index] = nullptr;
+			UpdateEngagement(Index);
+			continue;
+		}
+		// Left behind by the runner; stays engaged so it resumes if significance promotes it again
+		if (Significances[Index] == EEnemySignificance::Dormant)
+		{
+			continue;
+		}
+
+		// With a crowd running, aim at whichever runner is closest
+		FVector AimLocation = Target->GetActorLocation();
+		FVector AimVelocity = Target->GetVelocity();
+		FVector CrowdLocation;
+		FVector CrowdVelocity;
+		if (Crowd != nullptr && Crowd->FindNearestRunner(Positions[Index], CrowdLocation, CrowdVelocity)
+			&& FVector::DistSquared(CrowdLocation, Positions[Index]) < FVector::DistSquared(AimLocation, Positions[Index]))
+		{
+			AimLocation = CrowdLocation;
+			AimVelocity = CrowdVelocity;
+		}
+
+		const FVector ToTarget = AimLocation - Positions[Index];
+		const float Yaw = FMath::RadiansToDegrees(FMath::Atan2(ToTarget.Y, ToTarget.X));
+		if (!FMath::IsNearlyEqual(Yaw, Yaws[Index], KINDA_SMALL_NUMBER))
+		{
+			Yaws[Index] = Yaw;
+			Enemies[Index]->RotateTowardsTarget(Yaw);
+		}
+
+		if (Now - LastFired[Index] >= FireRates[Index])
+		{
+			const FEnemyArchetype& EnemyArchetype = Archetypes.Get(ArchetypeIndices[Index]);
+			const FVector Muzzle = EnemyArchetype.GetMuzzleLocation(Enemies[Index]->GunMeshComponent);
+			if (EnemyArchetype.ProjectileSpeed > 0.0f)
+			{
+				FireSolver.Add(Muzzle, AimLocation, AimVelocity, EnemyArchetype.ProjectileSpeed, EnemyArchetype.ProjectileLifetime);
+				FiringIndices.Add(Index);
+			}
+			else
+			{
+				// Nothing to lead with, shoot where the target is
+				LastFired[Index] = Now;
+				Enemies[Index]->Fire(EnemyArchetype, Muzzle, AimLocation);
+			}
+		}
+	}
+	RUNNER_SET_COUNTER(RunnerEnemiesEngaged, EngagedIndices.Num());
+
+	// Shots without an intercept inside the projectile's lifetime are held until one appears
+	FireSolver.Solve();
+	for (int32 Shot = 0; Shot < FiringIndices.Num(); Shot++)
+	{
+		if (!FireSolver.HasSolution(Shot))
+		{
+			continue;
+		}
+		const int32 Index = FiringIndices[Shot];
+		LastFired[Index] = Now;
+		Enemies[Index]->Fire(Archetypes.Get(ArchetypeIndices[Index]), FireSolver.GetOrigin(Shot), FireSolver.GetAimPoint(Shot));
+	}
+}
+
+void UEnemyManagerSubsystem::UpdateSignificance(float Now)
+{
+	if (Now < NextSignificanceTime)
+	{
+		return;
+	}
+	NextSignificanceTime = Now + SignificanceInterval;
+	ACharacter* Runner = UGameplayStatics::GetPlayerCharacter(this, 0);
+	if (Runner == nullptr)
+	{
+		return;
+	}
+	const FVector RunnerLocation = Runner->GetActorLocation();
+	const FVector Forward = FRotator(0.0f, Runner->GetControlRotation().Yaw, 0.0f).Vector();
+
+	SignificanceOrder.Reset();
+	for (int32 Index = 0; Index < Enemies.Num(); Index++)
+	{
+		const float Ahead = FVector::DotProduct(Positions[Index] - RunnerLocation, Forward);
+		SignificanceOrder.Emplace(Ahead, Index);
+	}
+	// Nearest ahead first; enemies already passed rank below all of them, so they only take
+	// full-rate slots nothing ahead wants
+	SignificanceOrder.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B)
+	{
+		const bool bAheadA = A.Key >= 0.0f;
+		const bool bAheadB = B.Key >= 0.0f;
+		if (bAheadA != bAheadB)
+		{
+			return bAheadA;
+		}
+		return bAheadA ? A.Key < B.Key : A.Key > B.Key;
+	});
+
+	int32 NumFullRate = 0;
+	for (const TPair<float, int32>& Entry : SignificanceOrder)
+	{
+		const int32 Index = Entry.Value;
+		AEnemy* Enemy = Enemies[Index];
+		EEnemySignificance Significance = EEnemySignificance::Full;
+		if (!Alive[Index])
+		{
+			// Ragdolls need their mesh ticking until they come to rest
+			if (Enemy->MeshComponent->IsSimulatingPhysics())
+			{
+				continue;
+			}
+			Significance = EEnemySignificance::Dormant;
+		}
+		else if (Entry.Key < -DormantBehindDistance)
+		{
+			Significance = EEnemySignificance::Dormant;
+		}
+		else if (Entry.Key > FullRateDistance || NumFullRate >= MaxFullRateEnemies)
+		{
+			Significance = EEnemySignificance::Reduced;
+		}
+		else
+		{
+			NumFullRate++;
+		}
+
+		if (Significances[Index] != Significance)
+		{
+			Significances[Index] = Significance;
+			Enemy->ApplySignificance(Significance, ReducedTickInterval);
+		}
+	}
+}
+
+void UEnemyManagerSubsystem::UpdateDetection(ACharacter* Runner)
+{
+	if (!bUseSpatialDetection || Runner == nullptr)
+	{
+		return;
+	}
+	SCOPE_CYCLE_COUNTER(STAT_RunnerEnemyDetection);
+	const FVector RunnerLocation = Runner->GetActorLocation();
+	const FVector Margin(DetectionMargin);
+
+	OccupiedScratch.Reset();
+	CandidateScratch.Reset();
+	if (const TArray<AEnemy*>* Candidates = DetectionHash.Find(RunnerLocation))
+	{
+		CandidateScratch.Append(*Candidates);
+	}
+	for (AEnemy* Enemy : CandidateScratch)
+	{
+		FEnemyDetectionVolumes& Volumes = DetectionVolumes[Enemy->ManagerIndex];
+		const bool bInDetection = FBox(-Volumes.DetectionExtent - Margin, Volumes.DetectionExtent + Margin).IsInsideOrOn(Volumes.Detection.InverseTransformPosition(RunnerLocation));
+		const bool bInFireRange = FBox(-Volumes.FireRangeExtent - Margin, Volumes.FireRangeExtent + Margin).IsInsideOrOn(Volumes.FireRange.InverseTransformPosition(RunnerLocation));
+
+		// Only react on entry, the same way a begin overlap would
+		if (bInDetection && !Volumes.bRunnerInDetection)
+		{
+			Enemy->HandleRunnerDetected(Runner);
+		}
+		if (bInFireRange && !Volumes.bRunnerInFireRange)
+		{
+			Enemy->HandleRunnerInFireRange(Runner);
+		}
+		Volumes.bRunnerInDetection = bInDetection;
+		Volumes.bRunnerInFireRange = bInFireRange;
+		if (bInDetection || bInFireRange)
+		{
+			OccupiedScratch.Add(Enemy);
+		}
+	}
+
+	for (AEnemy* Enemy : OccupiedEnemies)
+	{
+		if (!OccupiedScratch.Contains(Enemy))
+		{
+			FEnemyDetectionVolumes& Volumes = DetectionVolumes[Enemy->ManagerIndex];
+			Volumes.bRunnerInDetection = false;
+			Volumes.bRunnerInFireRange = false;
+		}
+	}
+	Swap(OccupiedEnemies, OccupiedScratch);
+}
+
+TStatId UEnemyManagerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UEnemyManagerSubsystem, STATGROUP_Tickables);
+}
+
+bool UEnemyManagerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UEnemyManagerSubsystem::UpdateEngagement(int32 Index)
+{
+	const bool bEngaged = Alive[Index] && Targets[Index] != nullptr;
+	int32& Slot = EngagedSlots[Index];
+	if (bEngaged && Slot == INDEX_NONE)
+	{
+		Slot = EngagedIndices.Add(Index);
+		return;
+	}
+	if (!bEngaged && Slot != INDEX_NONE)
+	{
+		const int32 RemovedSlot = Slot;
+		EngagedIndices.RemoveAtSwap(RemovedSlot, 1, false);
+		if (EngagedIndices.IsValidIndex(RemovedSlot))
+		{
+			EngagedSlots[EngagedIndices[RemovedSlot]] = RemovedSlot;
+		}
+		Slot = INDEX_NONE;
+	}
+}
+
+void UEnemyManagerSubsystem::InsertDetectionVolumes(int32 Index)
+{
+	AEnemy* Enemy = Enemies[Index];
+	FEnemyDetectionVolumes& Volumes = DetectionVolumes[Index];
+	Volumes.Detection = Enemy->EnemyDetectionRange->GetComponentTransform();
+	Volumes.Detection.SetScale3D(FVector::OneVector);
+	Volumes.DetectionExtent = Enemy->EnemyDetectionRange->GetScaledBoxExtent();
+	Volumes.FireRange = Enemy->FireRange->GetComponentTransform();
+	Volumes.FireRange.SetScale3D(FVector::OneVector);
+	Volumes.FireRangeExtent = Enemy->FireRange->GetScaledBoxExtent();
+	Volumes.bRunnerInDetection = false;
+	Volumes.bRunnerInFireRange = false;
+
+	const FVector Margin(DetectionMargin);
+	Volumes.Bounds = FBox(-Volumes.DetectionExtent - Margin, Volumes.DetectionExtent + Margin).TransformBy(Volumes.Detection);
+	Volumes.Bounds += FBox(-Volumes.FireRangeExtent - Margin, Volumes.FireRangeExtent + Margin).TransformBy(Volumes.FireRange);
+	DetectionHash.Insert(Enemy, Volumes.Bounds);
+}
+
+void UEnemyManagerSubsystem::RemoveDetectionVolumes(int32 Index)
+{
+	DetectionHash.Remove(Enemies[Index], DetectionVolumes[Index].Bounds);
+}
@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Enemy.h"
+#include "EnemyArchetype.h"
+#include "EnemyFireSolver.h"
+#include "EnemySpatialHash.h"
+#include "EnemyManagerSubsystem.generated.h"
+
+class ACharacter;
+class UDataTable;
+
+/** World-space copies of an enemy's FireRange and EnemyDetectionRange boxes used by spatial detection */
+struct FEnemyDetectionVolumes
+{
+	FTransform Detection;
+
+	FVector DetectionExtent;
+
+	FTransform FireRange;
+
+	FVector FireRangeExtent;
+
+	/** Area registered in the spatial hash */
+	FBox Bounds;
+
+	bool bRunnerInDetection = false;
+
+	bool bRunnerInFireRange = false;
+};
+
+/**
+ * Owns the targeting state of every AEnemy in the world and updates the engaged ones in a single tick.
+ * Enemies only cost anything here while they are alive and have a target.
+ */
+UCLASS(config=Game)
+class RUNNER_API UEnemyManagerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	void RegisterEnemy(AEnemy* Enemy);
+
+	void UnregisterEnemy(AEnemy* Enemy);
+
+	/** Resets the enemy's slot to its spawn state, called from AEnemy::Start */
+	void ResetEnemy(AEnemy* Enemy);
+
+	/** Re-reads the enemy's detection boxes after they moved, keeping whether the runner is inside */
+	void RefreshDetectionVolumes(AEnemy* Enemy);
+
+	void SetTarget(AEnemy* Enemy, AActor* NewTarget);
+
+	void SetAlive(AEnemy* Enemy, bool bAlive);
+
+	/**
+	 * Tests the runner against the detection volumes of nearby enemies and fires the same
+	 * reactions as the overlap boxes would. Does nothing unless spatial detection is enabled.
+	 */
+	void UpdateDetection(ACharacter* Runner);
+
+	/** Baked archetype of a registered enemy, nullptr if it is not registered */
+	const FEnemyArchetype* GetArchetype(const AEnemy* Enemy) const;
+
+	bool IsUsingSpatialDetection() const { return bUseSpatialDetection; }
+
+	int32 GetNumEnemies() const { return Enemies.Num(); }
+
+	int32 GetNumEngaged() const { return EngagedIndices.Num(); }
+
+	/** Turns and fires the engaged enemies, called from Tick or once per fixed step */
+	void StepEnemies(float Now);
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void UpdateEngagement(int32 Index);
+
+	/** Clock enemies fire on, fixed-step time when the simulation runs fixed step */
+	float GetGameplayTime() const;
+
+	void InsertDetectionVolumes(int32 Index);
+
+	void RemoveDetectionVolumes(int32 Index);
+
+	/** Ranks enemies by how far ahead of the runner they are and throttles their meshes to match */
+	void UpdateSignificance(float Now);
+
+	/** DataTable of FEnemyArchetypeRow, baked once when the world starts */
+	UPROPERTY(Config)
+	FSoftObjectPath ArchetypeTable;
+
+	UPROPERTY()
+	UDataTable* LoadedArchetypeTable;
+
+	FEnemyArchetypeTable Archetypes;
+
+	/** Keeps the projectile classes referenced by baked archetypes loaded */
+	UPROPERTY()
+	TArray<UClass*> ArchetypeProjectiles;
+
+	/** Enemies further ahead than this run at a reduced rate */
+	UPROPERTY(Config)
+	float FullRateDistance = 3000.0f;
+
+	/** Enemies further behind the runner than this go dormant */
+	UPROPERTY(Config)
+	float DormantBehindDistance = 500.0f;
+
+	/** Cap on enemies at full rate, the closest ones win */
+	UPROPERTY(Config)
+	int32 MaxFullRateEnemies = 16;
+
+	/** Mesh tick interval for enemies at reduced rate */
+	UPROPERTY(Config)
+	float ReducedTickInterval = 0.1f;
+
+	/** Seconds between significance updates */
+	UPROPERTY(Config)
+	float SignificanceInterval = 0.25f;
+
+	float NextSignificanceTime = 0.0f;
+
+	/** Scratch buffer of (distance ahead, enemy index) reused by UpdateSignificance */
+	TArray<TPair<float, int32>> SignificanceOrder;
+
+	/** Replaces the per-enemy overlap boxes with lookups in the spatial hash */
+	UPROPERTY(Config)
+	bool bUseSpatialDetection = false;
+
+	UPROPERTY(Config)
+	float DetectionCellSize = 2000.0f;
+
+	/** Added to the detection volumes to account for the runner's capsule */
+	UPROPERTY(Config)
+	float DetectionMargin = 50.0f;
+
+	FEnemySpatialHash DetectionHash;
+
+	TArray<FEnemyDetectionVolumes> DetectionVolumes;
+
+	/** Enemies the runner was inside of last frame, so leaving them can re-arm their volumes */
+	TArray<AEnemy*> OccupiedEnemies;
+
+	TArray<AEnemy*> OccupiedScratch;
+
+	/** Copy of the hash cell being tested, reactions may move enemies between cells */
+	TArray<AEnemy*> CandidateScratch;
+
+	UPROPERTY()
+	TArray<AEnemy*> Enemies;
+
+	UPROPERTY()
+	TArray<AActor*> Targets;
+
+	TArray<FVector> Positions;
+
+	TArray<float> Yaws;
+
+	TArray<float> LastFired;
+
+	TArray<float> FireRates;
+
+	/** Shots due this frame, solved together once all engaged enemies have been visited */
+	FEnemyFireSolver FireSolver;
+
+	/** Enemy index of each shot queued in FireSolver */
+	TArray<int32> FiringIndices;
+
+	/** Index into Archetypes */
+	TArray<int32> ArchetypeIndices;
+
+	TArray<uint8> Alive;
+
+	TArray<EEnemySignificance> Significances;
+
+	/** Position of each enemy in EngagedIndices, INDEX_NONE when it is idle */
+	TArray<int32> EngagedSlots;
+
+	/** Enemies that are alive and have a target, the only ones visited by Tick */
+	TArray<int32> EngagedIndices;
+};
@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemySpatialHash.h"
+
+void FEnemySpatialHash::Insert(AEnemy* Enemy, const FBox& Bounds)
+{
+	const FIntPoint Min = ToCell(Bounds.Min.X, Bounds.Min.Y);
+	const FIntPoint Max = ToCell(Bounds.Max.X, Bounds.Max.Y);
+	for (int32 X = Min.X; X <= Max.X; X++)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+		{
+			Cells.FindOrAdd(FIntPoint(X, Y)).AddUnique(Enemy);
+		}
+	}
+}
+
+void FEnemySpatialHash::Remove(AEnemy* Enemy, const FBox& Bounds)
+{
+	const FIntPoint Min = ToCell(Bounds.Min.X, Bounds.Min.Y);
+	const FIntPoint Max = ToCell(Bounds.Max.X, Bounds.Max.Y);
+	for (int32 X = Min.X; X <= Max.X; X++)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+		{
+			if (TArray<AEnemy*>* Cell = Cells.Find(FIntPoint(X, Y)))
+			{
+				Cell->RemoveSwap(Enemy, false);
+			}
+		}
+	}
+}
+
+const TArray<AEnemy*>* FEnemySpatialHash::Find(const FVector& Location) const
+{
+	const TArray<AEnemy*>* Cell = Cells.Find(ToCell(Location.X, Location.Y));
+	return (Cell != nullptr && Cell->Num() > 0) ? Cell : nullptr;
+}
+
+FIntPoint FEnemySpatialHash::ToCell(float X, float Y) const
+{
+	return FIntPoint(FMath::FloorToInt(X / CellSize), FMath::FloorToInt(Y / CellSize));
+}
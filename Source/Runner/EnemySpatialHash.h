@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AEnemy;
+
+/**
+ * Uniform grid over the track plane bucketing enemies by the area their detection volumes cover.
+ * Lets the runner find the enemies that could see it with a single cell lookup.
+ */
+class RUNNER_API FEnemySpatialHash
+{
+public:
+	void SetCellSize(float InCellSize) { CellSize = FMath::Max(InCellSize, 1.0f); }
+
+	void Insert(AEnemy* Enemy, const FBox& Bounds);
+
+	void Remove(AEnemy* Enemy, const FBox& Bounds);
+
+	/** Enemies whose bounds touch the cell containing Location, or nullptr if there are none */
+	const TArray<AEnemy*>* Find(const FVector& Location) const;
+
+	void Reset() { Cells.Reset(); }
+
+private:
+	FIntPoint ToCell(float X, float Y) const;
+
+	float CellSize = 2000.0f;
+
+	TMap<FIntPoint, TArray<AEnemy*>> Cells;
+};
@@ -0,0 +1,315 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectilePoolSubsystem.h"
+#include "Runner.h"
+#include "RunnerFrameBudgetSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "Particles/ParticleSystemComponent.h"
+
+void UProjectilePoolSubsystem::WarmUp(TSubclassOf<AActor> ProjectileClass)
+{
+	if (ProjectileClass == nullptr)
+	{
+		return;
+	}
+	FindOrWarmPool(ProjectileClass);
+}
+
+void UProjectilePoolSubsystem::GetLaunchParams(TSubclassOf<AActor> ProjectileClass, float& OutSpeed, float& OutLifetime)
+{
+	OutSpeed = 0.0f;
+	OutLifetime = 0.0f;
+	if (ProjectileClass == nullptr)
+	{
+		return;
+	}
+	const FProjectilePool& Pool = FindOrWarmPool(ProjectileClass);
+	OutSpeed = Pool.Speed;
+	OutLifetime = Pool.Lifetime;
+}
+
+AActor* UProjectilePoolSubsystem::Acquire(TSubclassOf<AActor> ProjectileClass, const FVector& Location, const FRotator& Rotation, AActor* Shooter)
+{
+	if (ProjectileClass == nullptr)
+	{
+		return nullptr;
+	}
+	FProjectilePool& Pool = FindOrWarmPool(ProjectileClass);
+	const int32 Num = Pool.Actors.Num();
+	if (Num == 0)
+	{
+		return nullptr;
+	}
+
+	// Look for a free slot starting at the ring cursor, otherwise steal the slot under the cursor
+	int32 Index = INDEX_NONE;
+	for (int32 Offset = 0; Offset < Num; Offset++)
+	{
+		const int32 Candidate = (Pool.NextIndex + Offset) % Num;
+		if (Pool.ExpireTimes[Candidate] < 0.0)
+		{
+			Index = Candidate;
+			break;
+		}
+	}
+	bool bMissed = false;
+	if (Index == INDEX_NONE)
+	{
+		Index = Pool.NextIndex;
+		ReleaseSlot(Pool, Index);
+		bMissed = true;
+	}
+	if (Pool.Actors[Index] == nullptr)
+	{
+		// Warm-up has not reached this slot yet, spawn it now instead of waiting for the deferred task
+		Pool.Actors[Index] = SpawnPooledActor(ProjectileClass);
+	}
+	else if (!IsValid(Pool.Actors[Index]))
+	{
+		// Blueprint logic destroyed this one, so it has to be replaced
+		Pool.Actors[Index] = SpawnPooledActor(ProjectileClass);
+		bMissed = true;
+	}
+	if (bMissed)
+	{
+		Pool.Stats.Misses++;
+	}
+	else
+	{
+		Pool.Stats.Hits++;
+	}
+	Pool.NextIndex = (Index + 1) % Num;
+
+	AActor* Projectile = Pool.Actors[Index];
+	if (Projectile == nullptr)
+	{
+		return nullptr;
+	}
+	Projectile->SetOwner(Shooter);
+	ActivateProjectile(Projectile, Location, Rotation);
+	Pool.ExpireTimes[Index] = GetWorld()->GetTimeSeconds() + Pool.Lifetime;
+	Pool.NumActive++;
+	Pool.Stats.HighWater = FMath::Max(Pool.Stats.HighWater, Pool.NumActive);
+	return Projectile;
+}
+
+void UProjectilePoolSubsystem::Release(AActor* Projectile)
+{
+	if (Projectile == nullptr)
+	{
+		return;
+	}
+	FProjectilePool* Pool = Pools.Find(Projectile->GetClass());
+	if (Pool == nullptr)
+	{
+		return;
+	}
+	const int32 Index = Pool->Actors.Find(Projectile);
+	if (Index != INDEX_NONE)
+	{
+		ReleaseSlot(*Pool, Index);
+	}
+}
+
+FProjectilePoolStats UProjectilePoolSubsystem::GetStats() const
+{
+	FProjectilePoolStats Total;
+	for (const TPair<UClass*, FProjectilePool>& Pair : Pools)
+	{
+		Total.Hits += Pair.Value.Stats.Hits;
+		Total.Misses += Pair.Value.Stats.Misses;
+		Total.HighWater += Pair.Value.Stats.HighWater;
+	}
+	return Total;
+}
+
+int32 UProjectilePoolSubsystem::GetNumActive() const
+{
+	int32 NumActive = 0;
+	for (const TPair<UClass*, FProjectilePool>& Pair : Pools)
+	{
+		NumActive += Pair.Value.NumActive;
+	}
+	return NumActive;
+}
+
+void UProjectilePoolSubsystem::GetActiveProjectiles(TArray<AActor*>& OutProjectiles) const
+{
+	OutProjectiles.Reset();
+	for (const TPair<UClass*, FProjectilePool>& Pair : Pools)
+	{
+		const FProjectilePool& Pool = Pair.Value;
+		for (int32 Index = 0; Pool.NumActive > 0 && Index < Pool.ExpireTimes.Num(); Index++)
+		{
+			if (Pool.ExpireTimes[Index] >= 0.0 && IsValid(Pool.Actors[Index]))
+			{
+				OutProjectiles.Add(Pool.Actors[Index]);
+			}
+		}
+	}
+}
+
+void UProjectilePoolSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	SCOPE_CYCLE_COUNTER(STAT_RunnerProjectilePoolTick);
+	const double Now = GetWorld()->GetTimeSeconds();
+	int32 NumActive = 0;
+	for (TPair<UClass*, FProjectilePool>& Pair : Pools)
+	{
+		FProjectilePool& Pool = Pair.Value;
+		if (Pool.NumActive == 0)
+		{
+			continue;
+		}
+		for (int32 Index = 0; Index < Pool.ExpireTimes.Num(); Index++)
+		{
+			if (Pool.ExpireTimes[Index] >= 0.0 && Pool.ExpireTimes[Index] <= Now)
+			{
+				ReleaseSlot(Pool, Index);
+			}
+		}
+		NumActive += Pool.NumActive;
+	}
+	RUNNER_SET_COUNTER(RunnerProjectilesAlive, NumActive);
+}
+
+TStatId UProjectilePoolSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProjectilePoolSubsystem, STATGROUP_Tickables);
+}
+
+bool UProjectilePoolSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+FProjectilePool& UProjectilePoolSubsystem::FindOrWarmPool(UClass* ProjectileClass)
+{
+	if (FProjectilePool* Existing = Pools.Find(ProjectileClass))
+	{
+		return *Existing;
+	}
+	FProjectilePool& Pool = Pools.Add(ProjectileClass);
+	const AActor* DefaultProjectile = ProjectileClass->GetDefaultObject<AActor>();
+	Pool.Lifetime = DefaultProjectile->InitialLifeSpan > 0.0f ? DefaultProjectile->InitialLifeSpan : DefaultLifetime;
+	Pool.Actors.Init(nullptr, RingSize);
+	Pool.ExpireTimes.Init(-1.0, RingSize);
+	if (RingSize > 0)
+	{
+		Pool.Actors[0] = SpawnPooledActor(ProjectileClass);
+	}
+
+	// The rest of the ring fills in over the next frames; Acquire spawns inline if it gets there first
+	for (int32 Index = 1; Index < RingSize; Index++)
+	{
+		URunnerFrameBudgetSubsystem::Defer(this, ERunnerWorkPriority::Low, [this, ProjectileClass, Index]()
+		{
+			FProjectilePool* Warming = Pools.Find(ProjectileClass);
+			if (Warming != nullptr && Warming->Actors[Index] == nullptr)
+			{
+				Warming->Actors[Index] = SpawnPooledActor(ProjectileClass);
+			}
+		});
+	}
+
+	// Blueprint components only exist on instances, so read the speed off a pooled actor
+	const AActor* Sample = Pool.Actors.Num() > 0 ? Pool.Actors[0] : nullptr;
+	if (const UProjectileMovementComponent* Movement = Sample ? Sample->FindComponentByClass<UProjectileMovementComponent>() : nullptr)
+	{
+		// Same rule ActivateProjectile launches with
+		Pool.Speed = Movement->InitialSpeed > 0.0f ? Movement->InitialSpeed : Movement->GetMaxSpeed();
+	}
+	return Pool;
+}
+
+AActor* UProjectilePoolSubsystem::SpawnPooledActor(UClass* ProjectileClass)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AActor* Projectile = GetWorld()->SpawnActor<AActor>(ProjectileClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams);
+	if (Projectile == nullptr)
+	{
+		return nullptr;
+	}
+	// The pool decides when a projectile expires, so cancel the InitialLifeSpan auto destroy
+	Projectile->SetLifeSpan(0.0f);
+	Projectile->OnActorHit.AddDynamic(this, &UProjectilePoolSubsystem::OnProjectileHit);
+	DeactivateProjectile(Projectile);
+	return Projectile;
+}
+
+void UProjectilePoolSubsystem::ActivateProjectile(AActor* Projectile, const FVector& Location, const FRotator& Rotation)
+{
+	Projectile->SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::ResetPhysics);
+	Projectile->SetActorHiddenInGame(false);
+	Projectile->SetActorEnableCollision(true);
+	Projectile->SetActorTickEnabled(true);
+
+	if (UProjectileMovementComponent* Movement = Projectile->FindComponentByClass<UProjectileMovementComponent>())
+	{
+		// A stopped projectile drops its updated component, so hook it back up before relaunching
+		Movement->SetUpdatedComponent(Projectile->GetRootComponent());
+		const float Speed = Movement->InitialSpeed > 0.0f ? Movement->InitialSpeed : Movement->GetMaxSpeed();
+		Movement->Velocity = Rotation.Vector() * Speed;
+		Movement->Activate(true);
+		Movement->UpdateComponentVelocity();
+	}
+
+	TInlineComponentArray<UFXSystemComponent*> Effects(Projectile);
+	for (UFXSystemComponent* Effect : Effects)
+	{
+		Effect->Activate(true);
+	}
+}
+
+void UProjectilePoolSubsystem::DeactivateProjectile(AActor* Projectile)
+{
+	if (UProjectileMovementComponent* Movement = Projectile->FindComponentByClass<UProjectileMovementComponent>())
+	{
+		Movement->StopMovementImmediately();
+		Movement->Deactivate();
+	}
+
+	TInlineComponentArray<UFXSystemComponent*> Effects(Projectile);
+	for (UFXSystemComponent* Effect : Effects)
+	{
+		Effect->Deactivate();
+	}
+
+	Projectile->SetActorTickEnabled(false);
+	Projectile->SetActorEnableCollision(false);
+	Projectile->SetActorHiddenInGame(true);
+}
+
+void UProjectilePoolSubsystem::ReleaseSlot(FProjectilePool& Pool, int32 Index)
+{
+	if (Pool.ExpireTimes[Index] < 0.0)
+	{
+		return;
+	}
+	Pool.ExpireTimes[Index] = -1.0;
+	Pool.NumActive--;
+	if (IsValid(Pool.Actors[Index]))
+	{
+		DeactivateProjectile(Pool.Actors[Index]);
+	}
+}
+
+void UProjectilePoolSubsystem::OnProjectileHit(AActor* SelfActor, AActor* OtherActor, FVector NormalImpulse, const FHitResult& Hit)
+{
+	FProjectilePool* Pool = Pools.Find(SelfActor->GetClass());
+	if (Pool == nullptr)
+	{
+		return;
+	}
+	const int32 Index = Pool->Actors.Find(SelfActor);
+	if (Index == INDEX_NONE || Pool->ExpireTimes[Index] < 0.0)
+	{
+		return;
+	}
+	// Still inside the hit dispatch, so let the next tick move it back into the ring
+	Pool->ExpireTimes[Index] = 0.0;
+}
@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProjectilePoolSubsystem.generated.h"
+
+USTRUCT(BlueprintType)
+struct FProjectilePoolStats
+{
+	GENERATED_BODY()
+
+	/** Acquires served by a free pooled actor */
+	UPROPERTY(BlueprintReadOnly, Category = "Projectile")
+	int32 Hits = 0;
+
+	/** Acquires that had to steal a busy slot or respawn a destroyed one */
+	UPROPERTY(BlueprintReadOnly, Category = "Projectile")
+	int32 Misses = 0;
+
+	/** Highest number of projectiles in flight at once */
+	UPROPERTY(BlueprintReadOnly, Category = "Projectile")
+	int32 HighWater = 0;
+};
+
+/** Fixed ring of pre-spawned actors for one projectile class */
+USTRUCT()
+struct FProjectilePool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<AActor*> Actors;
+
+	/** World time at which each slot is recycled, negative when the slot is free */
+	TArray<double> ExpireTimes;
+
+	int32 NextIndex = 0;
+
+	int32 NumActive = 0;
+
+	float Lifetime = 0.0f;
+
+	/** Launch speed of the projectile movement, zero if the class has none */
+	float Speed = 0.0f;
+
+	FProjectilePoolStats Stats;
+};
+
+/**
+ * Hands out pre-warmed projectile actors instead of spawning one per shot.
+ * Projectiles return to their ring when they hit something or their lifetime runs out.
+ */
+UCLASS(config=Game)
+class RUNNER_API UProjectilePoolSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Spawns the ring for a projectile class up front; does nothing if it already exists */
+	void WarmUp(TSubclassOf<AActor> ProjectileClass);
+
+	/** Places a pooled projectile at the given transform and launches it, owned by Shooter */
+	AActor* Acquire(TSubclassOf<AActor> ProjectileClass, const FVector& Location, const FRotator& Rotation, AActor* Shooter = nullptr);
+
+	/** Launch speed and lifetime of a projectile class, warming its ring if needed */
+	void GetLaunchParams(TSubclassOf<AActor> ProjectileClass, float& OutSpeed, float& OutLifetime);
+
+	/** Sends a projectile back to its ring */
+	void Release(AActor* Projectile);
+
+	UFUNCTION(BlueprintPure, Category = "Projectile")
+	FProjectilePoolStats GetStats() const;
+
+	int32 GetNumActive() const;
+
+	/** Fills OutProjectiles with every projectile currently in flight */
+	void GetActiveProjectiles(TArray<AActor*>& OutProjectiles) const;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Number of actors pre-spawned per projectile class */
+	UPROPERTY(Config)
+	int32 RingSize = 32;
+
+	/** Used when the projectile class does not set an InitialLifeSpan */
+	UPROPERTY(Config)
+	float DefaultLifetime = 3.0f;
+
+	UPROPERTY()
+	TMap<UClass*, FProjectilePool> Pools;
+
+	FProjectilePool& FindOrWarmPool(UClass* ProjectileClass);
+
+	AActor* SpawnPooledActor(UClass* ProjectileClass);
+
+	void ActivateProjectile(AActor* Projectile, const FVector& Location, const FRotator& Rotation);
+
+	void DeactivateProjectile(AActor* Projectile);
+
+	void ReleaseSlot(FProjectilePool& Pool, int32 Index);
+
+	UFUNCTION()
+	void OnProjectileHit(AActor* SelfActor, AActor* OtherActor, FVector NormalImpulse, const FHitResult& Hit);
+};
@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RagdollBudgetSubsystem.h"
+#include "Runner.h"
+#include "Enemy.h"
+#include "Engine/World.h"
+
+void URagdollBudgetSubsystem::AddRagdoll(AEnemy* Enemy)
+{
+	if (Enemy == nullptr || Ragdolls.Contains(Enemy))
+	{
+		return;
+	}
+	while (Ragdolls.Num() > 0 && Ragdolls.Num() >= MaxSimulating)
+	{
+		AEnemy* Oldest = Ragdolls[0];
+		RemoveAt(0);
+		if (IsValid(Oldest))
+		{
+			Oldest->Retire();
+		}
+	}
+	if (MaxSimulating <= 0)
+	{
+		Enemy->Retire();
+		return;
+	}
+
+	Enemy->StartRagdoll();
+	Ragdolls.Add(Enemy);
+	StartTimes.Add(GetWorld()->GetTimeSeconds());
+	RestTimes.Add(-1.0f);
+	RUNNER_SET_COUNTER(RunnerRagdollsSimulating, Ragdolls.Num());
+}
+
+void URagdollBudgetSubsystem::RemoveRagdoll(AEnemy* Enemy)
+{
+	const int32 Index = Ragdolls.Find(Enemy);
+	if (Index != INDEX_NONE)
+	{
+		RemoveAt(Index);
+	}
+}
+
+void URagdollBudgetSubsystem::RemoveAt(int32 Index)
+{
+	// Keep the order so index 0 is always the oldest ragdoll
+	Ragdolls.RemoveAt(Index, 1, false);
+	StartTimes.RemoveAt(Index, 1, false);
+	RestTimes.RemoveAt(Index, 1, false);
+	RUNNER_SET_COUNTER(RunnerRagdollsSimulating, Ragdolls.Num());
+}
+
+void URagdollBudgetSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	SCOPE_CYCLE_COUNTER(STAT_RunnerRagdollBudgetTick);
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	for (int32 Index = Ragdolls.Num() - 1; Index >= 0; Index--)
+	{
+		AEnemy* Enemy = Ragdolls[Index];
+		if (!IsValid(Enemy))
+		{
+			RemoveAt(Index);
+			continue;
+		}
+
+		if (Enemy->GetRagdollSpeed() > SettleSpeed)
+		{
+			RestTimes[Index] = -1.0f;
+		}
+		else if (RestTimes[Index] < 0.0f)
+		{
+			RestTimes[Index] = Now;
+		}
+
+		const bool bSettled = RestTimes[Index] >= 0.0f && Now - RestTimes[Index] >= SettleTime;
+		if (bSettled || Now - StartTimes[Index] >= MaxSimulateTime)
+		{
+			Enemy->FreezeRagdoll();
+			RemoveAt(Index);
+		}
+	}
+}
+
+TStatId URagdollBudgetSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URagdollBudgetSubsystem, STATGROUP_Tickables);
+}
+
+bool URagdollBudgetSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RagdollBudgetSubsystem.generated.h"
+
+class AEnemy;
+
+/**
+ * Caps how many dead enemies simulate physics at once. Ragdolls are frozen in place once they
+ * settle, and the oldest one is retired when a new death would go over budget.
+ */
+UCLASS(config=Game)
+class RUNNER_API URagdollBudgetSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Turns the enemy into a ragdoll, retiring the oldest one first if the budget is full */
+	void AddRagdoll(AEnemy* Enemy);
+
+	/** Stops tracking the enemy without touching it, called when it is reset or destroyed */
+	void RemoveRagdoll(AEnemy* Enemy);
+
+	int32 GetNumSimulating() const { return Ragdolls.Num(); }
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void RemoveAt(int32 Index);
+
+	/** Most ragdolls allowed to simulate at the same time */
+	UPROPERTY(Config)
+	int32 MaxSimulating = 6;
+
+	/** A ragdoll moving slower than this, in cm/s, counts as resting */
+	UPROPERTY(Config)
+	float SettleSpeed = 10.0f;
+
+	/** Seconds a ragdoll has to rest before it is frozen */
+	UPROPERTY(Config)
+	float SettleTime = 0.5f;
+
+	/** Ragdolls still moving after this many seconds are frozen anyway */
+	UPROPERTY(Config)
+	float MaxSimulateTime = 4.0f;
+
+	/** Simulating enemies, oldest first */
+	UPROPERTY()
+	TArray<AEnemy*> Ragdolls;
+
+	TArray<float> StartTimes;
+
+	/** World time the ragdoll came to rest, negative while it is still moving */
+	TArray<float> RestTimes;
+};
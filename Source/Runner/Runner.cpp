@@ -4,4 +4,42 @@
 #include "Modules/ModuleManager.h"
 
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Runner, "Runner" );
- 
\ No newline at end of file
+
+DEFINE_LOG_CATEGORY(LogRunner);
+
+DEFINE_STAT(STAT_RunnerEnemyTick);
+DEFINE_STAT(STAT_RunnerEnemyFire);
+DEFINE_STAT(STAT_RunnerEnemyRotate);
+DEFINE_STAT(STAT_RunnerEnemyDetection);
+DEFINE_STAT(STAT_RunnerCharacterTick);
+DEFINE_STAT(STAT_RunnerTurnCorner);
+DEFINE_STAT(STAT_RunnerSetAim);
+DEFINE_STAT(STAT_RunnerChangeLanes);
+DEFINE_STAT(STAT_RunnerLaneMotion);
+DEFINE_STAT(STAT_RunnerProjectilePoolTick);
+DEFINE_STAT(STAT_RunnerTrackGeneratorTick);
+DEFINE_STAT(STAT_RunnerRagdollBudgetTick);
+DEFINE_STAT(STAT_RunnerFixedStep);
+DEFINE_STAT(STAT_RunnerTrackInstancing);
+DEFINE_STAT(STAT_RunnerTrackCollision);
+DEFINE_STAT(STAT_RunnerFrameBudget);
+DEFINE_STAT(STAT_RunnerTrackMovement);
+DEFINE_STAT(STAT_RunnerCrowd);
+
+DEFINE_STAT(STAT_RunnerProjectilesAlive);
+DEFINE_STAT(STAT_RunnerEnemiesEngaged);
+DEFINE_STAT(STAT_RunnerTilesLive);
+DEFINE_STAT(STAT_RunnerRagdollsSimulating);
+DEFINE_STAT(STAT_RunnerTrackInstances);
+DEFINE_STAT(STAT_RunnerWorkQueued);
+DEFINE_STAT(STAT_RunnerWorkOverruns);
+DEFINE_STAT(STAT_RunnerCrowdRunners);
+
+TRACE_DECLARE_INT_COUNTER(RunnerProjectilesAlive, TEXT("Runner/Projectiles Alive"));
+TRACE_DECLARE_INT_COUNTER(RunnerEnemiesEngaged, TEXT("Runner/Enemies Engaged"));
+TRACE_DECLARE_INT_COUNTER(RunnerTilesLive, TEXT("Runner/Tiles Live"));
+TRACE_DECLARE_INT_COUNTER(RunnerRagdollsSimulating, TEXT("Runner/Ragdolls Simulating"));
+TRACE_DECLARE_INT_COUNTER(RunnerTrackInstances, TEXT("Runner/Track Instances"));
+TRACE_DECLARE_INT_COUNTER(RunnerWorkQueued, TEXT("Runner/Deferred Work Queued"));
+TRACE_DECLARE_INT_COUNTER(RunnerWorkOverruns, TEXT("Runner/Deferred Work Overruns"));
+TRACE_DECLARE_INT_COUNTER(RunnerCrowdRunners, TEXT("Runner/Crowd Runners"));
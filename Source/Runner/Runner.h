@@ -3,3 +3,58 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "ProfilingDebugging/CountersTrace.h"
+
+// Diagnostics below Warning are compiled out of shipping builds
+#if UE_BUILD_SHIPPING
+DECLARE_LOG_CATEGORY_EXTERN(LogRunner, Warning, Warning);
+#else
+DECLARE_LOG_CATEGORY_EXTERN(LogRunner, Log, All);
+#endif
+
+DECLARE_STATS_GROUP(TEXT("Runner"), STATGROUP_Runner, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enemy Tick"), STAT_RunnerEnemyTick, STATGROUP_Runner, RUNNER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enemy Fire"), STAT_RunnerEnemyFire, STATGROUP_Runner, RUNNER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enemy Rotate Towards Target"), STAT_RunnerEnemyRotate, STATGROUP_Runner, RUNNER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enemy Detection"), STAT_RunnerEnemyDetection, STATGROUP_Runner, RUNNER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Character Tick"), STAT_RunnerCharacterTick, STATGROUP_Runner, RUNNER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Character Turn Corner"), STAT_RunnerTurnCorner, STATGROUP_Runner, RUNNER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Character Set Aim"), STAT_RunnerSetAim, STATGROUP_Runner, RUNNER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Character Change Lanes"), STAT_RunnerChangeLanes, STATGROUP_Runner, RUNNER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Character Lane Motion"), STAT_RunnerLaneMotion, STATGROUP_Runner, RUNNER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Projectile Pool Tick"), STAT_RunnerProjectilePoolTick, STATGROUP_Runner, RUNNER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Track Generator Tick"), STAT_RunnerTrackGeneratorTick, STATGROUP_Runner, RUNNER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Ragdoll Budget Tick"), STAT_RunnerRagdollBudgetTick, STATGROUP_Runner, RUNNER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Fixed Step"), STAT_RunnerFixedStep, STATGROUP_Runner, RUNNER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Track Instancing"), STAT_RunnerTrackInstancing, STATGROUP_Runner, RUNNER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Track Collision"), STAT_RunnerTrackCollision, STATGROUP_Runner, RUNNER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Deferred Work"), STAT_RunnerFrameBudget, STATGROUP_Runner, RUNNER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Character Track Movement"), STAT_RunnerTrackMovement, STATGROUP_Runner, RUNNER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Crowd"), STAT_RunnerCrowd, STATGROUP_Runner, RUNNER_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Projectiles Alive"), STAT_RunnerProjectilesAlive, STATGROUP_Runner, RUNNER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Enemies Engaged"), STAT_RunnerEnemiesEngaged, STATGROUP_Runner, RUNNER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Tiles Live"), STAT_RunnerTilesLive, STATGROUP_Runner, RUNNER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Ragdolls Simulating"), STAT_RunnerRagdollsSimulating, STATGROUP_Runner, RUNNER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Track Instances"), STAT_RunnerTrackInstances, STATGROUP_Runner, RUNNER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Deferred Work Queued"), STAT_RunnerWorkQueued, STATGROUP_Runner, RUNNER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Deferred Work Overruns"), STAT_RunnerWorkOverruns, STATGROUP_Runner, RUNNER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Crowd Runners"), STAT_RunnerCrowdRunners, STATGROUP_Runner, RUNNER_API);
+
+TRACE_DECLARE_INT_COUNTER_EXTERN(RunnerProjectilesAlive);
+TRACE_DECLARE_INT_COUNTER_EXTERN(RunnerEnemiesEngaged);
+TRACE_DECLARE_INT_COUNTER_EXTERN(RunnerTilesLive);
+TRACE_DECLARE_INT_COUNTER_EXTERN(RunnerRagdollsSimulating);
+TRACE_DECLARE_INT_COUNTER_EXTERN(RunnerTrackInstances);
+TRACE_DECLARE_INT_COUNTER_EXTERN(RunnerWorkQueued);
+TRACE_DECLARE_INT_COUNTER_EXTERN(RunnerWorkOverruns);
+TRACE_DECLARE_INT_COUNTER_EXTERN(RunnerCrowdRunners);
+
+/** Publishes a value to both the Runner stat group and the Insights counter of the same name */
+#define RUNNER_SET_COUNTER(Name, Value) \
+	do \
+	{ \
+		SET_DWORD_STAT(STAT_##Name, Value); \
+		TRACE_COUNTER_SET(Name, Value); \
+	} while (0)
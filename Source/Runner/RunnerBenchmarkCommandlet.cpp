@@ -0,0 +1,342 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerBenchmarkCommandlet.h"
+#include "Runner.h"
+#include "Enemy.h"
+#include "EnemyManagerSubsystem.h"
+#include "ProjectilePoolSubsystem.h"
+#include "RunnerCharacter.h"
+#include "RunnerCrowdSubsystem.h"
+#include "RunnerFrameBudgetSubsystem.h"
+#include "RunnerGameMode.h"
+#include "TrackGeneratorComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/PlatformMemory.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace RunnerBenchmark
+{
+	static const TCHAR* DefaultCharacterPath = TEXT("/Game/ThirdPersonCPP/Blueprints/ThirdPersonCharacter.ThirdPersonCharacter_C");
+	static const TCHAR* DefaultEnemyPath = TEXT("/Game/Enemy/BP_EnemyBehindCover.BP_EnemyBehindCover_C");
+
+	/** Sim seconds between scripted commands */
+	static const float CommandInterval = 0.25f;
+
+	static const float EnemySpacing = 600.0f;
+
+	static int32 CountActors(UWorld* World)
+	{
+		int32 Count = 0;
+		for (TActorIterator<AActor> It(World); It; ++It)
+		{
+			Count++;
+		}
+		return Count;
+	}
+
+	/** Loads a map as a game world with its game mode, its track generated from Seed */
+	static UWorld* LoadMapWorld(const FString& MapPackage, int32 Seed)
+	{
+		UPackage* Package = LoadPackage(nullptr, *MapPackage, LOAD_None);
+		UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+		if (World == nullptr)
+		{
+			return nullptr;
+		}
+		World->AddToRoot();
+		World->WorldType = EWorldType::Game;
+		// Picks and spawns the map's game mode; standalone initialisation brings a world context and
+		// an empty world of its own, which the loaded map takes the place of
+		UGameInstance* GameInstance = NewObject<UGameInstance>(GEngine);
+		GameInstance->InitializeStandalone();
+		FWorldContext* WorldContext = GameInstance->GetWorldContext();
+		UWorld* StandaloneWorld = WorldContext->World();
+		WorldContext->SetCurrentWorld(World);
+		StandaloneWorld->DestroyWorld(false);
+		World->SetGameInstance(GameInstance);
+		World->InitWorld();
+
+		const FURL URL(*MapPackage);
+		World->SetGameMode(URL);
+		ARunnerGameMode* GameMode = World->GetAuthGameMode<ARunnerGameMode>();
+		if (GameMode != nullptr && GameMode->TrackGenerator != nullptr)
+		{
+			// Before BeginPlay, which is when the generator seeds its stream
+			GameMode->TrackGenerator->Seed = Seed;
+		}
+		else
+		{
+			UE_LOG(LogRunner, Warning, TEXT("%s has no runner game mode, the track will not match the recording"), *MapPackage);
+		}
+		World->InitializeActorsForPlay(URL);
+		World->BeginPlay();
+		return World;
+	}
+
+	/** Tears down either kind of benchmark world along with the game instance a map brought */
+	static void DestroyWorld(UWorld* World)
+	{
+		if (UGameInstance* GameInstance = World->GetGameInstance())
+		{
+			GameInstance->Shutdown();
+		}
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+		World->RemoveFromRoot();
+	}
+
+	static double Percentile(const TArray<double>& Sorted, double Fraction)
+	{
+		if (Sorted.Num() == 0)
+		{
+			return 0.0;
+		}
+		const int32 Index = FMath::Clamp(FMath::FloorToInt(Sorted.Num() * Fraction), 0, Sorted.Num() - 1);
+		return Sorted[Index];
+	}
+}
+
+URunnerBenchmarkCommandlet::URunnerBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 URunnerBenchmarkCommandlet::Main(const FString& Params)
+{
+	float Seconds = 60.0f;
+	float Dt = 1.0f / 60.0f;
+	int32 EnemiesPerType = 10;
+	int32 Seed = 0;
+	FString CharacterPath = RunnerBenchmark::DefaultCharacterPath;
+	FString EnemyPath = RunnerBenchmark::DefaultEnemyPath;
+	FString OutputPath = FPaths::ProjectSavedDir() / TEXT("Benchmarks/RunnerBenchmark.csv");
+	FParse::Value(*Params, TEXT("Seconds="), Seconds);
+	FParse::Value(*Params, TEXT("Dt="), Dt);
+	FParse::Value(*Params, TEXT("Enemies="), EnemiesPerType);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("Character="), CharacterPath);
+	FParse::Value(*Params, TEXT("Enemy="), EnemyPath);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	FString ReplayPath;
+	FRunnerInputRecording Recording;
+	const bool bReplay = FParse::Value(*Params, TEXT("Replay="), ReplayPath);
+	if (bReplay)
+	{
+		if (!Recording.Load(ReplayPath))
+		{
+			UE_LOG(LogRunner, Error, TEXT("Could not load input recording %s"), *ReplayPath);
+			return 1;
+		}
+		// Explicit parameters still win so a recording can be replayed at a different rate
+		if (Recording.GetStepSeconds() > 0.0f && !FParse::Value(*Params, TEXT("Dt="), Dt))
+		{
+			Dt = Recording.GetStepSeconds();
+		}
+		if (!FParse::Value(*Params, TEXT("Seed="), Seed))
+		{
+			Seed = Recording.GetSeed();
+		}
+		if (!FParse::Value(*Params, TEXT("Seconds="), Seconds))
+		{
+			Seconds = (Recording.GetLastStep() + 1) * Dt + 1.0f;
+		}
+		UE_LOG(LogRunner, Display, TEXT("Replaying %d commands over %u steps from %s"), Recording.Num(), Recording.GetLastStep(), *ReplayPath);
+	}
+
+	UClass* CharacterClass = LoadClass<ARunnerCharacter>(nullptr, *CharacterPath);
+	if (CharacterClass == nullptr)
+	{
+		UE_LOG(LogRunner, Error, TEXT("Could not load runner class %s"), *CharacterPath);
+		return 1;
+	}
+	UClass* EnemyClass = LoadClass<AEnemy>(nullptr, *EnemyPath);
+	if (EnemyClass == nullptr)
+	{
+		UE_LOG(LogRunner, Warning, TEXT("Could not load enemy class %s, using AEnemy"), *EnemyPath);
+		EnemyClass = AEnemy::StaticClass();
+	}
+
+	// Same seed and time step every run so the numbers are comparable between builds
+	FMath::RandInit(Seed);
+	FMath::SRandInit(Seed);
+	FRandomStream Script(Seed);
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(Dt);
+
+	// A replay runs on the map and track it was recorded on, otherwise on a synthetic floor
+	const bool bReplayMap = bReplay && !Recording.GetMap().IsEmpty();
+	UWorld* World = nullptr;
+	if (bReplayMap)
+	{
+		World = RunnerBenchmark::LoadMapWorld(Recording.GetMap(), Seed);
+		if (World == nullptr)
+		{
+			UE_LOG(LogRunner, Error, TEXT("Could not load map %s the recording was made on"), *Recording.GetMap());
+			return 1;
+		}
+	}
+	else
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, false, FName(TEXT("RunnerBenchmark")));
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+
+		// A long floor so the runner has ground for the whole run
+		const float TrackLength = 100000.0f;
+		if (UStaticMesh* Cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube")))
+		{
+			AStaticMeshActor* Floor = World->SpawnActor<AStaticMeshActor>(FVector(TrackLength * 0.5f, 0.0f, -50.0f), FRotator::ZeroRotator);
+			Floor->SetMobility(EComponentMobility::Movable);
+			Floor->GetStaticMeshComponent()->SetStaticMesh(Cube);
+			Floor->SetActorScale3D(FVector(TrackLength / 100.0f, 20.0f, 1.0f));
+		}
+	}
+
+	const FPlatformMemoryStats MemoryBefore = FPlatformMemory::GetStats();
+	const int32 ObjectsBefore = GUObjectArray.GetObjectArrayNumMinusAvailable();
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	APlayerController* Controller = World->SpawnActor<APlayerController>(SpawnParams);
+	FTransform RunnerStart(FVector(0.0f, 0.0f, 100.0f));
+	AGameModeBase* GameMode = World->GetAuthGameMode();
+	if (GameMode != nullptr && Controller != nullptr)
+	{
+		if (const AActor* PlayerStart = GameMode->FindPlayerStart(Controller))
+		{
+			RunnerStart = FTransform(FRotator(0.0f, PlayerStart->GetActorRotation().Yaw, 0.0f), PlayerStart->GetActorLocation());
+		}
+	}
+	ARunnerCharacter* Runner = World->SpawnActor<ARunnerCharacter>(CharacterClass, RunnerStart, SpawnParams);
+	if (Runner == nullptr || Controller == nullptr)
+	{
+		UE_LOG(LogRunner, Error, TEXT("Could not spawn the runner"));
+		RunnerBenchmark::DestroyWorld(World);
+		return 1;
+	}
+	Controller->Possess(Runner);
+	if (bReplay)
+	{
+		Runner->StartReplay(Recording);
+	}
+
+	// A recorded map brings its own enemies on the track tiles
+	const EEnemyTypes EnemyTypes[] = { EEnemyTypes::Cover, EEnemyTypes::Crouch, EEnemyTypes::Stand };
+	int32 EnemyCount = 0;
+	for (int32 Index = 0; Index < (bReplayMap ? 0 : EnemiesPerType); Index++)
+	{
+		for (EEnemyTypes EnemyType : EnemyTypes)
+		{
+			const float Side = (EnemyCount % 2 == 0) ? 1.0f : -1.0f;
+			const FTransform EnemyTransform(FRotator(0.0f, 180.0f, 0.0f), FVector(2000.0f + EnemyCount * RunnerBenchmark::EnemySpacing, Side * 600.0f, 100.0f));
+			AEnemy* Enemy = World->SpawnActorDeferred<AEnemy>(EnemyClass, EnemyTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+			Enemy->Type = EnemyType;
+			UGameplayStatics::FinishSpawningActor(Enemy, EnemyTransform);
+			EnemyCount++;
+		}
+	}
+
+	const int32 NumFrames = FMath::Max(1, FMath::CeilToInt(Seconds / Dt));
+	const int32 ActorsAtStart = RunnerBenchmark::CountActors(World);
+	TArray<double> FrameMs;
+	FrameMs.Reserve(NumFrames);
+	const ERunnerCommand Commands[] = { ERunnerCommand::MoveLeft, ERunnerCommand::MoveRight, ERunnerCommand::Slide, ERunnerCommand::Jump, ERunnerCommand::Fire };
+	float NextCommandTime = RunnerBenchmark::CommandInterval;
+	int32 PeakEngaged = 0;
+	int32 PeakQueued = 0;
+
+	const double WallStart = FPlatformTime::Seconds();
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		const float SimTime = Frame * Dt;
+		if (!bReplay && SimTime >= NextCommandTime)
+		{
+			Runner->HandleCommand(Commands[Script.RandRange(0, UE_ARRAY_COUNT(Commands) - 1)]);
+			NextCommandTime += RunnerBenchmark::CommandInterval;
+		}
+
+		const double FrameStart = FPlatformTime::Seconds();
+		FApp::SetCurrentTime(FApp::GetCurrentTime() + Dt);
+		FApp::SetDeltaTime(Dt);
+		World->Tick(LEVELTICK_All, Dt);
+		GFrameCounter++;
+		FrameMs.Add((FPlatformTime::Seconds() - FrameStart) * 1000.0);
+
+		if (UEnemyManagerSubsystem* EnemyManager = World->GetSubsystem<UEnemyManagerSubsystem>())
+		{
+			PeakEngaged = FMath::Max(PeakEngaged, EnemyManager->GetNumEngaged());
+		}
+		if (URunnerFrameBudgetSubsystem* Scheduler = World->GetSubsystem<URunnerFrameBudgetSubsystem>())
+		{
+			PeakQueued = FMath::Max(PeakQueued, Scheduler->GetNumQueued());
+		}
+	}
+	const double WallSeconds = FPlatformTime::Seconds() - WallStart;
+
+	const FPlatformMemoryStats MemoryAfter = FPlatformMemory::GetStats();
+	const int32 ObjectsAfter = GUObjectArray.GetObjectArrayNumMinusAvailable();
+	const int32 ActorsAtEnd = RunnerBenchmark::CountActors(World);
+	FProjectilePoolStats PoolStats;
+	if (UProjectilePoolSubsystem* ProjectilePool = World->GetSubsystem<UProjectilePoolSubsystem>())
+	{
+		PoolStats = ProjectilePool->GetStats();
+	}
+
+	FrameMs.Sort();
+	const double SimSeconds = NumFrames * Dt;
+	const double SimPerWall = WallSeconds > 0.0 ? SimSeconds / WallSeconds : 0.0;
+	const double P50 = RunnerBenchmark::Percentile(FrameMs, 0.50);
+	const double P99 = RunnerBenchmark::Percentile(FrameMs, 0.99);
+	const int64 MemoryDelta = int64(MemoryAfter.UsedPhysical) - int64(MemoryBefore.UsedPhysical);
+
+	UE_LOG(LogRunner, Display, TEXT("Simulated %.1fs in %.2fs wall (%.2f sim s / wall s), %d frames at dt %.4f"), SimSeconds, WallSeconds, SimPerWall, NumFrames, Dt);
+	UE_LOG(LogRunner, Display, TEXT("Game thread frame: p50 %.3f ms, p99 %.3f ms, max %.3f ms"), P50, P99, FrameMs.Last());
+	UE_LOG(LogRunner, Display, TEXT("Actors: %d at start, %d at end; enemies %d, peak engaged %d"), ActorsAtStart, ActorsAtEnd, EnemyCount, PeakEngaged);
+	UE_LOG(LogRunner, Display, TEXT("Allocations: %d UObjects, %lld KiB physical, peak %llu KiB; projectile pool hits %d, misses %d, high water %d"),
+		ObjectsAfter - ObjectsBefore, MemoryDelta / 1024, uint64(MemoryAfter.PeakUsedPhysical) / 1024, PoolStats.Hits, PoolStats.Misses, PoolStats.HighWater);
+	if (URunnerFrameBudgetSubsystem* Scheduler = World->GetSubsystem<URunnerFrameBudgetSubsystem>())
+	{
+		UE_LOG(LogRunner, Display, TEXT("Deferred work: peak queue depth %d, %d frames over budget"), PeakQueued, Scheduler->GetNumOverruns());
+	}
+	URunnerCrowdSubsystem* Crowd = World->GetSubsystem<URunnerCrowdSubsystem>();
+	if (Crowd != nullptr && Crowd->GetNumRunners() > 0)
+	{
+		UE_LOG(LogRunner, Display, TEXT("Crowd: %d runners on %d cores, step %.3f ms, %.1f runners/ms, %d obstacle hits"),
+			Crowd->GetNumRunners(), FPlatformMisc::NumberOfCoresIncludingHyperthreads(), Crowd->GetAverageStepMilliseconds(), Crowd->GetRunnersPerMillisecond(), Crowd->GetNumHits());
+	}
+
+	if (!OutputPath.IsEmpty())
+	{
+		const bool bWriteHeader = !FPaths::FileExists(OutputPath);
+		FString Line;
+		if (bWriteHeader)
+		{
+			Line += TEXT("Timestamp,Seed,Seconds,Dt,EnemiesPerType,SimPerWall,P50Ms,P99Ms,ActorsStart,ActorsEnd,PeakEngaged,NewObjects,MemoryDeltaKiB,PoolHits,PoolMisses,PoolHighWater\n");
+		}
+		Line += FString::Printf(TEXT("%s,%d,%.2f,%.6f,%d,%.3f,%.4f,%.4f,%d,%d,%d,%d,%lld,%d,%d,%d\n"),
+			*FDateTime::UtcNow().ToIso8601(), Seed, Seconds, Dt, EnemiesPerType, SimPerWall, P50, P99,
+			ActorsAtStart, ActorsAtEnd, PeakEngaged, ObjectsAfter - ObjectsBefore, MemoryDelta / 1024, PoolStats.Hits, PoolStats.Misses, PoolStats.HighWater);
+		FFileHelper::SaveStringToFile(Line, *OutputPath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+	}
+
+	RunnerBenchmark::DestroyWorld(World);
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	return 0;
+}
@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "RunnerBenchmarkCommandlet.generated.h"
+
+/**
+ * Runs the gameplay loop headlessly at a fixed time step and reports how fast it simulates.
+ *
+ * UnrealEditor-Cmd Runner.uproject -run=RunnerBenchmark -nullrhi -unattended
+ *     [-Seconds=60] [-Dt=0.0166667] [-Enemies=10] [-Seed=0]
+ *     [-Character=/Game/...] [-Enemy=/Game/...] [-Output=Saved/Benchmarks/RunnerBenchmark.csv]
+ *     [-Replay=Saved/Replays/Session.rnri] [-Crowd=N | -Crowd]
+ *
+ * With -Replay the scripted commands are replaced by a recording made with -RecordInput=. The run
+ * happens on the recorded map with its track generated from the recorded seed, and the time step
+ * and length default to the recording's. Recordings without a map fall back to the synthetic floor. -Crowd adds bot runners (see
+ * URunnerCrowdSubsystem, a bare -Crowd scales with the core count) and reports runners per ms.
+ */
+UCLASS()
+class URunnerBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	URunnerBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -1,6 +1,7 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "RunnerCharacter.h"
+#include "Runner.h"
 #include "HeadMountedDisplayFunctionLibrary.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
@@ -8,17 +9,32 @@
 #include "Components/SkeletalMeshComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/Controller.h"
+#include "GameFramework/PlayerController.h"
 #include "GameFramework/SpringArmComponent.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Kismet/GameplayStatics.h"
 #include "Animation/AnimInstance.h"
-
-#define print(text) if (GEngine) GEngine->AddOnScreenDebugMessage(-1, 1.5, FColor::Red,text)
+#include "Animation/AnimMontage.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "EnemyManagerSubsystem.h"
+#include "ProjectilePoolSubsystem.h"
+#include "RunnerSimulationSubsystem.h"
+#include "RunnerGestureComponent.h"
+#include "RunnerMovementComponent.h"
+#include "RunnerPreloadSubsystem.h"
+#include "RunnerVisualState.h"
+#include "RunnerGameMode.h"
+#include "TrackGeneratorComponent.h"
+#include "TrackCollisionSubsystem.h"
+#include "RunnerTelemetrySubsystem.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Paths.h"
 
 //////////////////////////////////////////////////////////////////////////
 // ARunnerCharacter
 
-ARunnerCharacter::ARunnerCharacter()
+ARunnerCharacter::ARunnerCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<URunnerMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
@@ -31,8 +47,20 @@ ARunnerCharacter::ARunnerCharacter()
 	bUseControllerRotationPitch = false;
 	bUseControllerRotationYaw = false;
 	bUseControllerRotationRoll = false;
-	bIsSliding = false;
+	SimulationTime = 0.0f;
 	bCanTurn = false;
+	bLaneFramePending = false;
+	bFixedStep = false;
+	SimulationStep = 0;
+	bIsRecording = false;
+	bIsReplaying = false;
+	ReplayCursor = 0;
+	ReplayCommandStep = 0;
+	bHasReplayCommand = false;
+	ProjectileClass = nullptr;
+	LoadedSlideMontage = nullptr;
+	NumPendingAimTraces = 0;
+	bHasAimLocation = false;
 
 	// Configure character movement
 	GetCharacterMovement()->bOrientRotationToMovement = true; // Character moves in the direction of input...	
@@ -55,6 +83,8 @@ ARunnerCharacter::ARunnerCharacter()
 	GunMeshComponent = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("Gun"));
 	GunMeshComponent->SetupAttachment(GetMesh(), WeaponSocketName);
 
+	GestureComponent = CreateDefaultSubobject<URunnerGestureComponent>(TEXT("Gesture"));
+
 	// Note: The skeletal mesh and anim blueprint references on the Mesh component (inherited from Character) 
 	// are set in the derived blueprint asset named MyCharacter (to avoid direct content references in C++)
 }
@@ -66,13 +96,14 @@ void ARunnerCharacter::SetupPlayerInputComponent(class UInputComponent* PlayerIn
 {
 	// Set up gameplay key bindings
 	check(PlayerInputComponent);
-	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &ACharacter::Jump);
-	PlayerInputComponent->BindAction("Jump", IE_Released, this, &ACharacter::StopJumping);
-	PlayerInputComponent->BindAction("Fire", IE_Pressed, this, &ARunnerCharacter::StartFire);
-	PlayerInputComponent->BindAction("MoveRight", IE_Pressed, this, &ARunnerCharacter::MoveRight);
-	PlayerInputComponent->BindAction("MoveLeft", IE_Pressed, this, &ARunnerCharacter::MoveLeft);
+	// Everything gameplay-relevant goes through HandleCommand so it can be recorded
+	PlayerInputComponent->BindAction<FRunnerCommandDelegate>("Jump", IE_Pressed, this, &ARunnerCharacter::HandleCommand, ERunnerCommand::Jump);
+	PlayerInputComponent->BindAction<FRunnerCommandDelegate>("Jump", IE_Released, this, &ARunnerCharacter::HandleCommand, ERunnerCommand::StopJump);
+	PlayerInputComponent->BindAction<FRunnerCommandDelegate>("Fire", IE_Pressed, this, &ARunnerCharacter::HandleCommand, ERunnerCommand::Fire);
+	PlayerInputComponent->BindAction<FRunnerCommandDelegate>("MoveRight", IE_Pressed, this, &ARunnerCharacter::HandleCommand, ERunnerCommand::MoveRight);
+	PlayerInputComponent->BindAction<FRunnerCommandDelegate>("MoveLeft", IE_Pressed, this, &ARunnerCharacter::HandleCommand, ERunnerCommand::MoveLeft);
 
-	PlayerInputComponent->BindAction("Crouch", IE_Pressed, this, &ARunnerCharacter::SlideStarted);
+	PlayerInputComponent->BindAction<FRunnerCommandDelegate>("Crouch", IE_Pressed, this, &ARunnerCharacter::HandleCommand, ERunnerCommand::Slide);
 
 	PlayerInputComponent->BindAxis("MoveForward", this, &ARunnerCharacter::MoveForward);
 	
@@ -92,6 +123,7 @@ void ARunnerCharacter::SetupPlayerInputComponent(class UInputComponent* PlayerIn
 	// handle touch devices
 	PlayerInputComponent->BindTouch(IE_Pressed, this, &ARunnerCharacter::TouchStarted);
 	PlayerInputComponent->BindTouch(IE_Released, this, &ARunnerCharacter::TouchStopped);
+	PlayerInputComponent->BindTouch(IE_Repeat, this, &ARunnerCharacter::TouchMoved);
 
 	// VR headset functionality
 	PlayerInputComponent->BindAction("ResetVR", IE_Pressed, this, &ARunnerCharacter::OnResetVR);
@@ -99,9 +131,74 @@ void ARunnerCharacter::SetupPlayerInputComponent(class UInputComponent* PlayerIn
 
 void ARunnerCharacter::Tick(float DeltaTime)
 {
+	SCOPE_CYCLE_COUNTER(STAT_RunnerCharacterTick);
 	Super::Tick(DeltaTime);
-	TurnCorner();
-	MoveForward(1.0);
+	if (!bFixedStep)
+	{
+		SimulateStep(DeltaTime);
+	}
+}
+
+URunnerMovementComponent* ARunnerCharacter::GetRunnerMovement() const
+{
+	return CastChecked<URunnerMovementComponent>(GetCharacterMovement());
+}
+
+void ARunnerCharacter::SimulateStep(float DeltaTime)
+{
+	if (bIsReplaying)
+	{
+		ReplayCommands();
+	}
+	SimulationStep++;
+	SimulationTime += DeltaTime;
+	UpdateMovementState();
+	if (MovementState.GetState() == ERunnerMovementState::Dead)
+	{
+		return;
+	}
+	TurnCorner(DeltaTime);
+	UpdateLaneMotion(DeltaTime);
+	if (!GetRunnerMovement()->IsOnTrack())
+	{
+		MoveForward(1.0);
+	}
+
+	if (UEnemyManagerSubsystem* EnemyManager = GetWorld()->GetSubsystem<UEnemyManagerSubsystem>())
+	{
+		EnemyManager->UpdateDetection(this);
+	}
+	if (UTrackCollisionSubsystem* Collision = GetWorld()->GetSubsystem<UTrackCollisionSubsystem>())
+	{
+		Collision->UpdateRunner(this);
+	}
+}
+
+void ARunnerCharacter::FixedStep(float StepSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RunnerCharacterTick);
+	PreviousStepLocation = GetActorLocation();
+	SimulateStep(StepSeconds);
+	UCharacterMovementComponent* Movement = GetCharacterMovement();
+	Movement->TickComponent(StepSeconds, LEVELTICK_All, &Movement->PrimaryComponentTick);
+}
+
+void ARunnerCharacter::InterpolateVisuals(float Alpha)
+{
+	// The capsule sits at the latest step, so pull the visuals back towards the previous one
+	const FVector Offset = GetActorTransform().InverseTransformVectorNoScale(FMath::Lerp(PreviousStepLocation, GetActorLocation(), Alpha) - GetActorLocation());
+	GetMesh()->SetRelativeLocation(MeshBaseLocation + Offset);
+	CameraBoom->SetRelativeLocation(CameraBoomBaseLocation + Offset);
+}
+
+void ARunnerCharacter::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+	// Before any BeginPlay, the track generator queues lane frames from its own
+	LaneSystem.Init(LanesPositions, DesiredRotation.Yaw);
+	// The starting lane is set per instance and may name a lane the lane list does not have
+	CurrentLane = FMath::Clamp(CurrentLane, 0, FMath::Max(LaneSystem.GetNumLanes() - 1, 0));
+	TargetLane = CurrentLane;
 }
 
 void ARunnerCharacter::BeginPlay()
@@ -109,10 +206,74 @@ void ARunnerCharacter::BeginPlay()
 	Super::BeginPlay();
 	GunMeshComponent->AttachToComponent(GetMesh(), FAttachmentTransformRules::SnapToTargetIncludingScale, WeaponSocketName);
 	//GunMeshComponent->AttachTo(GetMesh(), WeaponSocketName, EAttachLocation::SnapToTarget, false);
+	// Only used for visuals, the runner plays the same without one (e.g. on a dedicated server)
 	AnimInstance = (GetMesh()) ? GetMesh()->GetAnimInstance() : nullptr;
-	AnimInstance->OnPlayMontageNotifyBegin.AddDynamic(this, &ARunnerCharacter::SlideEnded);
+	if (!bShieldUsesPrimitiveData)
+	{
+		BodyMaterial = GetMesh()->CreateAndSetMaterialInstanceDynamic(0);
+	}
+	MovementState.Reset();
+	SimulationTime = 0.0f;
+	if (UTrackCollisionSubsystem* Collision = GetWorld()->GetSubsystem<UTrackCollisionSubsystem>())
+	{
+		Collision->OnRunnerHitObstacle.AddUObject(this, &ARunnerCharacter::OnHitObstacle);
+	}
+
+	AimTraceDelegate.BindUObject(this, &ARunnerCharacter::OnAimTraceDone);
+	GestureComponent->OnGesture.BindUObject(this, &ARunnerCharacter::OnGesture);
+	TargetLane = CurrentLane;
 
-	BodyMaterial = GetMesh()->CreateAndSetMaterialInstanceDynamic(0);
+	ProjectileClass = Cast<UClass>(URunnerPreloadSubsystem::Resolve(Projectile.ToSoftObjectPath()));
+	LoadedSlideMontage = Cast<UAnimMontage>(URunnerPreloadSubsystem::Resolve(SlideMontage.ToSoftObjectPath()));
+	if (UProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>())
+	{
+		ProjectilePool->WarmUp(ProjectileClass);
+	}
+
+	URunnerSimulationSubsystem* Simulation = GetWorld()->GetSubsystem<URunnerSimulationSubsystem>();
+	bFixedStep = Simulation != nullptr && Simulation->IsFixedStep();
+
+	if (FParse::Value(FCommandLine::Get(), TEXT("RecordInput="), RecordingPath))
+	{
+		ARunnerGameMode* GameMode = GetWorld()->GetAuthGameMode<ARunnerGameMode>();
+		StartRecording(GameMode && GameMode->TrackGenerator ? GameMode->TrackGenerator->Seed : 0);
+	}
+	if (bFixedStep)
+	{
+		// Movement only advances in FixedStep so run speed no longer depends on frame rate
+		GetCharacterMovement()->SetComponentTickEnabled(false);
+		PreviousStepLocation = GetActorLocation();
+		MeshBaseLocation = GetMesh()->GetRelativeLocation();
+		CameraBoomBaseLocation = CameraBoom->GetRelativeLocation();
+		Simulation->OnFixedStep.AddUObject(this, &ARunnerCharacter::FixedStep);
+		Simulation->OnInterpolate.AddUObject(this, &ARunnerCharacter::InterpolateVisuals);
+	}
+}
+
+void ARunnerCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bIsRecording && !RecordingPath.IsEmpty())
+	{
+		const FString Path = FPaths::IsRelative(RecordingPath) ? FPaths::ProjectSavedDir() / TEXT("Replays") / RecordingPath : RecordingPath;
+		if (InputRecording.Save(Path))
+		{
+			UE_LOG(LogRunner, Log, TEXT("Saved %d commands over %u steps to %s (%d bytes)"), InputRecording.Num(), SimulationStep, *Path, InputRecording.GetNumBytes());
+		}
+		else
+		{
+			UE_LOG(LogRunner, Warning, TEXT("Could not save input recording to %s"), *Path);
+		}
+	}
+	if (URunnerSimulationSubsystem* Simulation = GetWorld()->GetSubsystem<URunnerSimulationSubsystem>())
+	{
+		Simulation->OnFixedStep.RemoveAll(this);
+		Simulation->OnInterpolate.RemoveAll(this);
+	}
+	if (UTrackCollisionSubsystem* Collision = GetWorld()->GetSubsystem<UTrackCollisionSubsystem>())
+	{
+		Collision->OnRunnerHitObstacle.RemoveAll(this);
+	}
+	Super::EndPlay(EndPlayReason);
 }
 
 
@@ -129,113 +290,229 @@ void ARunnerCharacter::OnResetVR()
 
 void ARunnerCharacter::JumpOrCrouchAxis(float Value)
 {
-	//print(FString::Printf(TEXT("Vertical axis value is %f!"), Value));
 	if (Value > .9f)
 	{
 		if (GetCharacterMovement()->IsFalling())
 		{
 			return;
 		}
-		Jump();
+		HandleCommand(ERunnerCommand::Jump);
 		return;
 	}
-	if (Value < -.9f)
+	// Held axes fire every frame, HandleCommand only records the ones that take effect
+	if (Value < -.9f && !IsSliding())
 	{
-		SlideStarted();
+		HandleCommand(ERunnerCommand::Slide);
 		return;
 	}
 }
 
 void ARunnerCharacter::TouchStarted(ETouchIndex::Type FingerIndex, FVector Location)
 {
-	TouchDownLoc = Location;
+	GestureComponent->TouchBegin(FingerIndex, FVector2D(Location));
+}
+
+void ARunnerCharacter::TouchMoved(ETouchIndex::Type FingerIndex, FVector Location)
+{
+	GestureComponent->TouchMove(FingerIndex, FVector2D(Location));
 }
 
 void ARunnerCharacter::TouchStopped(ETouchIndex::Type FingerIndex, FVector Location)
 {
-	FVector DiffVector = Location - TouchDownLoc;
+	GestureComponent->TouchEnd(FingerIndex, FVector2D(Location));
+}
 
-	if (DiffVector.Length() < 20.0)
+void ARunnerCharacter::OnGesture(ERunnerCommand Command, const FVector2D& ScreenLocation)
+{
+	if (Command != ERunnerCommand::Fire)
 	{
-		FVector tempWorldLocation;
-		FVector tempWorldDirection;
-		UGameplayStatics::GetPlayerController(this, 0)->DeprojectScreenPositionToWorld(Location.X, Location.Y, tempWorldLocation, tempWorldDirection);
-		Fire(SetAim(tempWorldLocation, tempWorldDirection));
+		HandleCommand(Command);
 		return;
 	}
-	if (FMath::Abs(DiffVector.X) > FMath::Abs(DiffVector.Y))
+	APlayerController* PlayerController = UGameplayStatics::GetPlayerController(this, 0);
+	if (PlayerController == nullptr || !RecordCommand(Command))
 	{
-		if (DiffVector.X > 0)
-		{
-			MoveRight();
-			return;
-		}
-		MoveLeft();
+		return;
 	}
-	if (DiffVector.Y > 0)
+	FVector tempWorldLocation;
+	FVector tempWorldDirection;
+	PlayerController->DeprojectScreenPositionToWorld(ScreenLocation.X, ScreenLocation.Y, tempWorldLocation, tempWorldDirection);
+	AimAndFire(tempWorldLocation, tempWorldDirection);
+}
+
+void ARunnerCharacter::HandleCommand(ERunnerCommand Command)
+{
+	if (bIsReplaying)
 	{
-		Jump();
 		return;
 	}
-	SlideStarted();
+	// A command that changed nothing replays to nothing, so it is not worth a byte
+	if (ExecuteCommand(Command))
+	{
+		RecordCommand(Command);
+	}
 }
 
-void ARunnerCharacter::ChangeLanes(int ShiftLane)
+bool ARunnerCharacter::RecordCommand(ERunnerCommand Command)
 {
-	TargetLane = UKismetMathLibrary::Clamp(CurrentLane + ShiftLane, 0, LanesPositions.Num() - 1);
+	if (bIsReplaying)
+	{
+		return false;
+	}
+	if (bIsRecording)
+	{
+		InputRecording.Add(SimulationStep, uint8(Command));
+	}
+	return true;
+}
 
-	print(FString::Printf(TEXT("Target lane is %d"), TargetLane));
+void ARunnerCharacter::StartRecording(int32 Seed)
+{
+	URunnerSimulationSubsystem* Simulation = GetWorld()->GetSubsystem<URunnerSimulationSubsystem>();
+	// Replays load the same map with the same track seed before injecting commands
+	const FString Map = UWorld::RemovePIEPrefix(GetWorld()->GetOutermost()->GetName());
+	InputRecording.Reset(Simulation ? Simulation->GetStepSeconds() : 0.0f, Seed, Map);
+	bIsRecording = true;
+	bIsReplaying = false;
+}
 
-	float Value = LanesPositions[TargetLane].Y - LanesPositions[CurrentLane].Y;
+void ARunnerCharacter::StartReplay(const FRunnerInputRecording& Recording)
+{
+	InputRecording = Recording;
+	bIsRecording = false;
+	bIsReplaying = true;
+	ReplayCursor = 0;
+	ReplayCommandStep = 0;
+	uint8 Command = 0;
+	bHasReplayCommand = InputRecording.Read(ReplayCursor, ReplayCommandStep, Command);
+	ReplayCommand = ERunnerCommand(Command);
+}
 
-	// find out which way is right
-	const FRotator Rotation = Controller->GetControlRotation();
-	const FRotator YawRotation(0, Rotation.Yaw, 0);
+void ARunnerCharacter::ReplayCommands()
+{
+	// Commands are stamped with the number of steps run before they arrived
+	while (bHasReplayCommand && ReplayCommandStep <= SimulationStep)
+	{
+		ExecuteCommand(ReplayCommand);
+		uint8 Command = 0;
+		bHasReplayCommand = InputRecording.Read(ReplayCursor, ReplayCommandStep, Command);
+		ReplayCommand = ERunnerCommand(Command);
+	}
+}
 
-	// get right vector 
-	const FVector Direction = FRotationMatrix(YawRotation).GetUnitAxis(EAxis::Y);
-	// add movement in that direction
-	//AddMovementInput(Direction, Value);
-	FVector TargetDirection = LanesPositions[TargetLane] - GetActorLocation();
+bool ARunnerCharacter::ExecuteCommand(ERunnerCommand Command)
+{
+	if (MovementState.GetState() == ERunnerMovementState::Dead)
+	{
+		return false;
+	}
+	switch (Command)
+	{
+	case ERunnerCommand::MoveLeft:
+		return MoveLeft();
+	case ERunnerCommand::MoveRight:
+		return MoveRight();
+	case ERunnerCommand::Slide:
+		return SlideStarted();
+	case ERunnerCommand::Jump:
+		if (!CanJump() || !MovementState.TryEnter(ERunnerMovementState::Jump, SimulationTime))
+		{
+			return false;
+		}
+		Jump();
+		return true;
+	case ERunnerCommand::StopJump:
+		// Ends the jump's hold time, which decides how high it goes
+		StopJumping();
+		return true;
+	case ERunnerCommand::Fire:
+		StartFire();
+		return true;
+	}
+	return false;
+}
 
-	FVector NewDirection = TargetDirection * Direction;
-	//NewLocation.Y = Value;
-	SetActorLocation(GetActorLocation() + NewDirection);
+bool ARunnerCharacter::ChangeLanes(int ShiftLane)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RunnerChangeLanes);
+	if (LaneSystem.GetNumLanes() == 0)
+	{
+		return false;
+	}
+	const int32 NewLane = UKismetMathLibrary::Clamp(CurrentLane + ShiftLane, 0, LaneSystem.GetNumLanes() - 1);
+	if (NewLane == CurrentLane)
+	{
+		return false;
+	}
+	TargetLane = NewLane;
 
-	//SetActorLocation(GetActorLocation() + Direction * Value);
+	UE_LOG(LogRunner, Verbose, TEXT("Target lane is %d"), TargetLane);
+	URunnerTelemetrySubsystem::RecordEvent(this, ERunnerTelemetryEvent::LaneChange, TargetLane);
 
+	// The actual sideways move happens in UpdateLaneMotion
 	CurrentLane = TargetLane;
+	return true;
 }
 
-void ARunnerCharacter::ActivateShield()
+void ARunnerCharacter::UpdateLaneMotion(float DeltaTime)
 {
-	if (bIsShielded)
+	SCOPE_CYCLE_COUNTER(STAT_RunnerLaneMotion);
+	URunnerMovementComponent* RunnerMovement = GetRunnerMovement();
+	if (LaneSystem.GetNumLanes() == 0 || bLaneFramePending)
+	{
+		RunnerMovement->ClearLaneTarget();
+		return;
+	}
+	if (RunnerMovement->IsOnTrack())
 	{
+		// Folded into the movement sweep rather than a sweep of its own
+		RunnerMovement->SetLaneTarget(LaneSystem.GetActiveFrame(), LaneSystem.GetLaneOffset(TargetLane), LaneChangeSpeed);
 		return;
 	}
-	if (!BodyMaterial)
+	const float Remaining = LaneSystem.GetLaneOffset(TargetLane) - LaneSystem.GetLateralOffset(GetActorLocation());
+	if (FMath::IsNearlyZero(Remaining, 1.0f))
 	{
 		return;
 	}
-	BodyMaterial->SetScalarParameterValue(FName("Active"), 1.0f);
-	FTimerDelegate CustomDelegate;
-	CustomDelegate.BindUFunction(this, FName("DeactivateShield"), &ARunnerCharacter::DeactivateShield);
-	GetWorldTimerManager().SetTimer(ShieldTimerHandle, CustomDelegate, ShieldTime, false);
+	const float MaxStep = LaneChangeSpeed * DeltaTime;
+	const float Step = FMath::Clamp(Remaining, -MaxStep, MaxStep);
+	AddActorWorldOffset(LaneSystem.GetActiveFrame().Right * Step, true);
+}
+
+void ARunnerCharacter::ActivateShield()
+{
+	if (bIsShielded)
+	{
+		return;
+	}
+	SetShieldVisual(1.0f);
+	URunnerTelemetrySubsystem::RecordEvent(this, ERunnerTelemetryEvent::ShieldOn);
+	GetWorldTimerManager().SetTimer(ShieldTimerHandle, this, &ARunnerCharacter::DeactivateShield, ShieldTime, false);
 	bIsShielded = true;
 }
 
 void ARunnerCharacter::DeactivateShield()
 {
 	bIsShielded = false;
-	if (!BodyMaterial)
+	SetShieldVisual(0.0f);
+	URunnerTelemetrySubsystem::RecordEvent(this, ERunnerTelemetryEvent::ShieldOff);
+}
+
+void ARunnerCharacter::SetShieldVisual(float Active)
+{
+	if (bShieldUsesPrimitiveData)
 	{
-		return;
+		FRunnerVisualState::Set(GetMesh(), ERunnerVisualState::Shield, Active);
+	}
+	else if (BodyMaterial)
+	{
+		BodyMaterial->SetScalarParameterValue(FName("Active"), Active);
 	}
-	BodyMaterial->SetScalarParameterValue(FName("Active"), 0.0f);
 }
 
 FVector ARunnerCharacter::SetAim(FVector worldLocation, FVector worldDirection)
 {
+	SCOPE_CYCLE_COUNTER(STAT_RunnerSetAim);
 	FVector muzzleLoc = GunMeshComponent->GetSocketLocation(MuzzleSocketName);
 	FVector end = worldLocation + worldDirection * 4000;
 	FRotator weaponRotation = UKismetMathLibrary::FindLookAtRotation(muzzleLoc, end);
@@ -252,27 +529,73 @@ FVector ARunnerCharacter::SetAim(FVector worldLocation, FVector worldDirection)
 	}
 	Pitch = newRotator.Pitch;
 	Yaw = newRotator.Yaw;
-	FHitResult HitResult;
-	FCollisionQueryParams CollisionQueryParams;
-	CollisionQueryParams.AddIgnoredActor(this);
-	if (GetWorld()->LineTraceSingleByChannel(HitResult, worldLocation, end, ECollisionChannel::ECC_Camera, CollisionQueryParams))
+	return end;
+}
+
+void ARunnerCharacter::AimAndFire(FVector worldLocation, FVector worldDirection)
+{
+	const FVector end = SetAim(worldLocation, worldDirection);
+	if (NumPendingAimTraces < MaxPendingAimTraces)
 	{
-		return HitResult.Location;
+		QueueAimTrace(worldLocation, end);
+		return;
 	}
+	// Too many traces in flight, shoot now rather than add latency
+	Fire(bHasAimLocation ? GetLastAimLocation() : end);
+}
 
-	return end;
+void ARunnerCharacter::GetAimRay(FVector& worldLocation, FVector& worldDirection) const
+{
+	APlayerController* PlayerController = UGameplayStatics::GetPlayerController(this, 0);
+	if (PlayerController == nullptr || !PlayerController->DeprojectMousePositionToWorld(worldLocation, worldDirection))
+	{
+		// No viewport to deproject into (headless runs), so shoot straight down the track
+		worldLocation = GetActorLocation();
+		worldDirection = GetControlRotation().Vector();
+	}
 }
 
 void ARunnerCharacter::StartFire()
 {
 	FVector tempWorldLocation;
 	FVector tempWorldDirection;
-	UGameplayStatics::GetPlayerController(this, 0)->DeprojectMousePositionToWorld(tempWorldLocation, tempWorldDirection);
-	Fire(SetAim(tempWorldLocation, tempWorldDirection));
+	GetAimRay(tempWorldLocation, tempWorldDirection);
+	AimAndFire(tempWorldLocation, tempWorldDirection);
+}
+
+void ARunnerCharacter::QueueAimTrace(const FVector& Start, const FVector& End)
+{
+	FCollisionQueryParams CollisionQueryParams(SCENE_QUERY_STAT(RunnerAim), false, this);
+	GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, Start, End, ECollisionChannel::ECC_Camera, CollisionQueryParams, FCollisionResponseParams::DefaultResponseParam, &AimTraceDelegate);
+	NumPendingAimTraces++;
+}
+
+void ARunnerCharacter::OnAimTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum)
+{
+	NumPendingAimTraces = FMath::Max(NumPendingAimTraces - 1, 0);
+	const FVector AimLocation = TraceDatum.OutHits.Num() > 0 && TraceDatum.OutHits[0].bBlockingHit ? FVector(TraceDatum.OutHits[0].Location) : TraceDatum.End;
+	LastAimOffset = GetAimFrame().InverseTransformPositionNoScale(AimLocation);
+	bHasAimLocation = true;
+	Fire(AimLocation);
+}
+
+FVector ARunnerCharacter::GetLastAimLocation() const
+{
+	return GetAimFrame().TransformPositionNoScale(LastAimOffset);
+}
+
+FTransform ARunnerCharacter::GetAimFrame() const
+{
+	// Heading rather than actor rotation, which wobbles with lane changes
+	return FTransform(FRotator(0.0f, GetControlRotation().Yaw, 0.0f), GetActorLocation());
 }
 
 void ARunnerCharacter::Fire(FVector aimLoc)
 {
+	if (MovementState.GetState() == ERunnerMovementState::Dead)
+	{
+		return;
+	}
 	if (GetCharacterMovement()->IsCrouching())
 	{
 		return;
@@ -281,49 +604,146 @@ void ARunnerCharacter::Fire(FVector aimLoc)
 	{
 		return;
 	}
+	UProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>();
+	if (ProjectilePool == nullptr)
+	{
+		return;
+	}
 	
 	FVector muzzleLoc = GunMeshComponent->GetSocketLocation(MuzzleSocketName);
 	FRotator prjRot = UKismetMathLibrary::FindLookAtRotation(muzzleLoc, aimLoc);
-	FActorSpawnParameters SpawnParams;
-	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-	GetWorld()->SpawnActor<AActor>(Projectile, muzzleLoc, prjRot, SpawnParams);
+	if (ProjectilePool->Acquire(ProjectileClass, muzzleLoc, prjRot, this) != nullptr)
+	{
+		URunnerTelemetrySubsystem::RecordEvent(this, ERunnerTelemetryEvent::Fire);
+	}
 }
 
-void ARunnerCharacter::TurnCorner()
+void ARunnerCharacter::TurnCorner(float DeltaTime)
 {
+	SCOPE_CYCLE_COUNTER(STAT_RunnerTurnCorner);
 	if (!Controller)
 	{
 		return;
 	}
+	if (!GetControlRotation().Equals(DesiredRotation, 1.0f))
+	{
+		Controller->SetControlRotation(UKismetMathLibrary::RInterpTo(GetControlRotation(), DesiredRotation, DeltaTime, 5));
+		return;
+	}
+	// The interpolation only creeps towards the target, finish the last degree in one step
 	if (!GetControlRotation().Equals(DesiredRotation))
 	{
-		Controller->SetControlRotation(UKismetMathLibrary::RInterpTo(GetControlRotation(), DesiredRotation, GetWorld()->DeltaTimeSeconds, 5));
+		Controller->SetControlRotation(DesiredRotation);
+	}
+	if (bLaneFramePending)
+	{
+		LaneSystem.OnCornerTurned(DesiredRotation.Yaw, GetActorLocation(), CurrentLane);
+		bLaneFramePending = false;
+	}
+	if (MovementState.GetState() == ERunnerMovementState::Turn)
+	{
+		MovementState.TryEnter(ERunnerMovementState::Run, SimulationTime);
 	}
 }
 
-void ARunnerCharacter::SlideStarted()
+bool ARunnerCharacter::StartCornerTurn(float Yaw)
 {
-	if (bIsSliding)
+	// A corner swipe is never a lane change, even when the turn is refused
+	if (!MovementState.TryEnter(ERunnerMovementState::Turn, SimulationTime))
 	{
-		return;
+		return false;
+	}
+	// Turning again before the last turn finished, settle the lane frame of the previous corner first
+	if (bLaneFramePending)
+	{
+		LaneSystem.OnCornerTurned(DesiredRotation.Yaw, GetActorLocation(), CurrentLane);
 	}
+	DesiredRotation = UKismetMathLibrary::ComposeRotators(DesiredRotation, FRotator(0, Yaw, 0));
+	bCanTurn = false;
+	bLaneFramePending = true;
+	return true;
+}
+
+bool ARunnerCharacter::SlideStarted()
+{
 	if (GetCharacterMovement()->IsFalling())
 	{
-		return;
-	}	
-	if (AnimInstance == nullptr)
+		return false;
+	}
+	if (!MovementState.TryEnter(ERunnerMovementState::Slide, SimulationTime, SlideDuration))
 	{
-		return;
+		return false;
 	}
-	bIsSliding = true;
 	Crouch();
-	AnimInstance->Montage_Play(SlideMontage, 1.0f);
+	URunnerTelemetrySubsystem::RecordEvent(this, ERunnerTelemetryEvent::Slide);
+	if (AnimInstance != nullptr && LoadedSlideMontage != nullptr)
+	{
+		AnimInstance->Montage_Play(LoadedSlideMontage, 1.0f);
+	}
+	return true;
 }
 
-void ARunnerCharacter::SlideEnded(FName NotifyName, const FBranchingPointNotifyPayload& BranchingPointPayload)
+void ARunnerCharacter::SlideEnded()
 {
-	bIsSliding = false;
 	UnCrouch();
+	if (AnimInstance != nullptr && LoadedSlideMontage != nullptr)
+	{
+		AnimInstance->Montage_Stop(0.2f, LoadedSlideMontage);
+	}
+}
+
+void ARunnerCharacter::UpdateMovementState()
+{
+	const ERunnerMovementState Previous = MovementState.Update(SimulationTime);
+	if (Previous == ERunnerMovementState::Slide && !IsSliding())
+	{
+		SlideEnded();
+	}
+
+	// A jump that never left the ground gets no Landed call, give it a moment to take off first
+	constexpr float TakeoffTime = 0.25f;
+	if (MovementState.GetState() == ERunnerMovementState::Jump && !GetCharacterMovement()->IsFalling() && MovementState.GetTimeInState(SimulationTime) > TakeoffTime)
+	{
+		MovementState.TryEnter(ERunnerMovementState::Run, SimulationTime);
+	}
+}
+
+void ARunnerCharacter::Landed(const FHitResult& Hit)
+{
+	Super::Landed(Hit);
+	// The track mode lands without a movement mode change, which is where the jump count is normally reset
+	ResetJumpState();
+	if (MovementState.GetState() == ERunnerMovementState::Jump)
+	{
+		MovementState.TryEnter(ERunnerMovementState::Run, SimulationTime);
+	}
+}
+
+void ARunnerCharacter::Die()
+{
+	if (IsSliding())
+	{
+		SlideEnded();
+	}
+	if (!MovementState.TryEnter(ERunnerMovementState::Dead, SimulationTime))
+	{
+		return;
+	}
+	GetCharacterMovement()->DisableMovement();
+	if (ARunnerGameMode* GameMode = GetWorld()->GetAuthGameMode<ARunnerGameMode>())
+	{
+		GameMode->RunnerDied(this);
+	}
+}
+
+void ARunnerCharacter::OnHitObstacle(ARunnerCharacter* Runner, AActor* Obstacle)
+{
+	if (Runner != this || bIsShielded)
+	{
+		return;
+	}
+	UE_LOG(LogRunner, Log, TEXT("Runner ran into %s"), *GetNameSafe(Obstacle));
+	Die();
 }
 
 void ARunnerCharacter::TurnAtRate(float Rate)
@@ -352,30 +772,25 @@ void ARunnerCharacter::MoveForward(float Value)
 	}
 }
 
-void ARunnerCharacter::MoveRight()
+bool ARunnerCharacter::MoveRight()
 {
-	if (bIsSliding)
+	if (IsSliding())
 	{
-		return;
+		return false;
 	}
 	if (GetCharacterMovement()->IsFalling())
 	{
-		return;
+		return false;
 	}
 	if (Controller == nullptr)
 	{
-		return;
+		return false;
 	}
 	if (bCanTurn)
 	{
-		DesiredRotation = UKismetMathLibrary::ComposeRotators(DesiredRotation, FRotator(0, 90, 0));
-		bCanTurn = false;
-		return;
-	}
-	else
-	{
-		ChangeLanes(1);
+		return StartCornerTurn(90.0f);
 	}
+	return ChangeLanes(1);
 		/*
 		// find out which way is right
 		const FRotator Rotation = Controller->GetControlRotation();
@@ -388,28 +803,23 @@ void ARunnerCharacter::MoveRight()
 		*/
 }
 
-void ARunnerCharacter::MoveLeft()
+bool ARunnerCharacter::MoveLeft()
 {
-	if (bIsSliding)
+	if (IsSliding())
 	{
-		return;
+		return false;
 	}
 	if (GetCharacterMovement()->IsFalling())
 	{
-		return;
+		return false;
 	}
 	if (Controller == nullptr)
 	{
-		return;
+		return false;
 	}
 	if (bCanTurn)
 	{
-		DesiredRotation = UKismetMathLibrary::ComposeRotators(DesiredRotation, FRotator(0, -90, 0));
-		bCanTurn = false;
-		return;
-	}
-	else
-	{
-		ChangeLanes(-1);
+		return StartCornerTurn(-90.0f);
 	}
+	return ChangeLanes(-1);
 }
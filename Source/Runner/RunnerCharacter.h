@@ -4,8 +4,27 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "WorldCollision.h"
+#include "RunnerLaneSystem.h"
+#include "RunnerInputRecording.h"
+#include "RunnerMovementState.h"
 #include "RunnerCharacter.generated.h"
 
+/** Gameplay-level commands the runner reacts to, whatever device produced them */
+UENUM(BlueprintType)
+enum class ERunnerCommand : uint8
+{
+	MoveLeft	UMETA(DisplayName = "Move Left"),
+	MoveRight	UMETA(DisplayName = "Move Right"),
+	Slide		UMETA(DisplayName = "Slide"),
+	Jump		UMETA(DisplayName = "Jump"),
+	Fire		UMETA(DisplayName = "Fire"),
+	// 5 and 6 were fire pressed and released, left unused so older recordings still decode
+	StopJump = 7	UMETA(DisplayName = "Jump Released")
+};
+
+DECLARE_DELEGATE_OneParam(FRunnerCommandDelegate, ERunnerCommand);
+
 UCLASS(config=Game)
 class ARunnerCharacter : public ACharacter
 {
@@ -22,10 +41,12 @@ class ARunnerCharacter : public ACharacter
 	UPROPERTY(VisibleAnywhere, Category = Weapon)
 	class USkeletalMeshComponent* GunMeshComponent;
 
-	FVector TouchDownLoc;
+	/** Turns touch input into commands */
+	UPROPERTY(VisibleAnywhere, Category = Control)
+	class URunnerGestureComponent* GestureComponent;
 
 public:
-	ARunnerCharacter();
+	ARunnerCharacter(const FObjectInitializer& ObjectInitializer);
 
 	/** Base turn rate, in deg/sec. Other scaling may affect final turn rate. */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=Camera)
@@ -41,8 +62,6 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Weapon)
 	float Yaw;
 
-	bool bIsSliding;
-
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = Movement)
 	bool bCanTurn;
 
@@ -55,10 +74,18 @@ public:
 	FName WeaponSocketName;
 
 	UPROPERTY(EditDefaultsOnly, Category = Weapon)
-	TSubclassOf<AActor> Projectile;
+	TSoftClassPtr<AActor> Projectile;
+
+	/** Aim traces allowed in flight at once, further shots reuse the last resolved aim point */
+	UPROPERTY(EditDefaultsOnly, Category = Weapon)
+	int32 MaxPendingAimTraces = 4;
 
 	UPROPERTY(EditDefaultsOnly, Category = Control)
-	class UAnimMontage* SlideMontage;
+	TSoftObjectPtr<class UAnimMontage> SlideMontage;
+
+	/** Seconds a slide lasts, the montage is only the visual */
+	UPROPERTY(EditDefaultsOnly, Category = Control)
+	float SlideDuration = 1.0f;
 
 	UPROPERTY(EditDefaultsOnly, Category = Shield)
 	float ShieldTime = 5.0f;
@@ -66,6 +93,13 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = Shield)
 	bool bIsShielded;
 
+	/**
+	 * Set once the body material reads its Active parameter from custom primitive data index 0.
+	 * Until then the shield is shown through a dynamic instance of the body material.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = Shield)
+	bool bShieldUsesPrimitiveData = false;
+
 	class UAnimInstance* AnimInstance;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Control)
@@ -76,6 +110,39 @@ public:
 
 	int TargetLane;
 
+	/** Sideways speed while moving between lanes, in cm/sec */
+	UPROPERTY(EditDefaultsOnly, Category = Control)
+	float LaneChangeSpeed = 1500.0f;
+
+	FRunnerLaneSystem& GetLaneSystem() { return LaneSystem; }
+
+	class URunnerMovementComponent* GetRunnerMovement() const;
+
+	UFUNCTION(BlueprintPure, Category = Movement)
+	ERunnerMovementState GetMovementState() const { return MovementState.GetState(); }
+
+	bool IsSliding() const { return MovementState.GetState() == ERunnerMovementState::Slide; }
+
+	/** Stops the run for good: no more movement, commands or shots. The game mode handles game over */
+	UFUNCTION(BlueprintCallable, Category = Movement)
+	void Die();
+
+	/** Runs a gameplay command as if it came from the bound input; ignored while a replay is playing */
+	UFUNCTION(BlueprintCallable, Category = Control)
+	void HandleCommand(ERunnerCommand Command);
+
+	/** Records every command that takes effect from now on, stamped with the simulation step it lands on */
+	void StartRecording(int32 Seed);
+
+	/** Ignores live input and plays the recording's commands back at their steps */
+	void StartReplay(const FRunnerInputRecording& Recording);
+
+	bool IsReplaying() const { return bIsReplaying; }
+
+	bool IsReplayFinished() const { return bIsReplaying && !bHasReplayCommand; }
+
+	const FRunnerInputRecording& GetInputRecording() const { return InputRecording; }
+
 protected:
 
 	/** Resets HMD orientation in VR. */
@@ -84,10 +151,10 @@ protected:
 	/** Called for forwards/backward input */
 	void MoveForward(float Value);
 
-	/** Called for side to side input */
-	void MoveRight();
+	/** Called for side to side input, false if the runner could not turn or change lanes */
+	bool MoveRight();
 
-	void MoveLeft();
+	bool MoveLeft();
 
 	/** 
 	 * Called via input to turn at a given rate. 
@@ -110,8 +177,15 @@ protected:
 	/** Handler for when a touch input stops. */
 	void TouchStopped(ETouchIndex::Type FingerIndex, FVector Location);
 
+	/** Handler for a touch moving while held. */
+	void TouchMoved(ETouchIndex::Type FingerIndex, FVector Location);
+
+	/** Runs the command the gesture component recognised, taps shoot at the touched point */
+	void OnGesture(ERunnerCommand Command, const FVector2D& ScreenLocation);
+
+	/** Shifts the target lane, false when the shift would leave the track and the lane is unchanged */
 	UFUNCTION(BlueprintCallable, Category = Control)
-	void ChangeLanes(int ShiftLane);
+	bool ChangeLanes(int ShiftLane);
 
 	UFUNCTION(BlueprintCallable, Category = Shield)
 	void ActivateShield();
@@ -119,24 +193,133 @@ protected:
 	UFUNCTION()
 	void DeactivateShield();
 
-	UMaterialInstanceDynamic* BodyMaterial;
+	/** Shows or hides the shield on the body material */
+	void SetShieldVisual(float Active);
+
+	/** Only created while bShieldUsesPrimitiveData is off */
+	UPROPERTY()
+	class UMaterialInstanceDynamic* BodyMaterial;
+
+	/** Projectile and SlideMontage, resolved from the preload manifest in BeginPlay */
+	UPROPERTY()
+	UClass* ProjectileClass;
+
+	UPROPERTY()
+	class UAnimMontage* LoadedSlideMontage;
 
 	FTimerHandle ShieldTimerHandle;
 
+	/** Points the weapon along the aim ray and returns the end of the ray */
 	FVector SetAim(FVector worldLocation, FVector worldDirection);
 
+	/** Aims along the ray and shoots once the aim trace resolves next frame */
+	void AimAndFire(FVector worldLocation, FVector worldDirection);
+
+	/** Gets the aim ray under the cursor, or straight down the track without a viewport */
+	void GetAimRay(FVector& worldLocation, FVector& worldDirection) const;
+
 	void StartFire();
 
+	/** Traces the aim ray in the background and shoots at whatever it hits */
+	void QueueAimTrace(const FVector& Start, const FVector& End);
+
+	void OnAimTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum);
+
+	FTraceDelegate AimTraceDelegate;
+
+	int32 NumPendingAimTraces;
+
+	/** Last resolved aim point relative to the runner, so it follows the runner round corners */
+	FVector LastAimOffset;
+
+	/** Last resolved aim point in world space, used when a shot cannot wait for a trace */
+	FVector GetLastAimLocation() const;
+
+	/** Runner location facing down the track, the space LastAimOffset is kept in */
+	FTransform GetAimFrame() const;
+
+	bool bHasAimLocation;
+
 	UFUNCTION(BlueprintCallable, Category = Weapon)
 	void Fire(FVector aimLoc);
 
-	void TurnCorner();
+	void TurnCorner(float DeltaTime);
+
+	/** Starts turning the runner Yaw degrees at a corner, false if its state does not allow a turn */
+	bool StartCornerTurn(float Yaw);
+
+	/** Runs a command, false if it changed nothing (e.g. a jump while airborne) */
+	bool ExecuteCommand(ERunnerCommand Command);
+
+	/** Logs a live command if recording; false when live input is locked out by a replay */
+	bool RecordCommand(ERunnerCommand Command);
+
+	/** Runs the replayed commands due at the current step */
+	void ReplayCommands();
+
+	FRunnerInputRecording InputRecording;
+
+	/** Steps simulated since BeginPlay, the time base of recordings */
+	uint32 SimulationStep;
+
+	bool bIsRecording;
+
+	bool bIsReplaying;
+
+	/** Where the recording is written in EndPlay, from -RecordInput= */
+	FString RecordingPath;
+
+	int32 ReplayCursor;
+
+	uint32 ReplayCommandStep;
+
+	ERunnerCommand ReplayCommand;
+
+	bool bHasReplayCommand;
+
+	/** One step of runner gameplay: turning, lane motion, held fire, running forward and enemy detection */
+	void SimulateStep(float DeltaTime);
+
+	/** Steps gameplay and character movement together at the simulation's fixed rate */
+	void FixedStep(float StepSeconds);
+
+	/** Places the mesh and camera between the last two fixed steps */
+	void InterpolateVisuals(float Alpha);
+
+	/** True when URunnerSimulationSubsystem drives the runner instead of Tick */
+	bool bFixedStep;
+
+	/** Actor location before the latest fixed step */
+	FVector PreviousStepLocation;
+
+	FVector MeshBaseLocation;
+
+	FVector CameraBoomBaseLocation;
+
+	/** Slides the runner sideways towards TargetLane in the active lane frame */
+	void UpdateLaneMotion(float DeltaTime);
+
+	FRunnerLaneSystem LaneSystem;
+
+	/** Set when a corner turn was requested and the next lane frame is picked once it completes */
+	bool bLaneFramePending;
 
 	UFUNCTION(Category=Control)
-	void SlideStarted();
+	bool SlideStarted();
 
-	UFUNCTION()
-	void SlideEnded(FName NotifyName, const FBranchingPointNotifyPayload& BranchingPointPayload);
+	/** Stands back up once the slide has run its time */
+	void SlideEnded();
+
+	/** Ends timed states and catches landings the movement component did not report */
+	void UpdateMovementState();
+
+	/** Obstacle contact from UTrackCollisionSubsystem, fatal unless shielded */
+	void OnHitObstacle(ARunnerCharacter* Runner, AActor* Obstacle);
+
+	FRunnerMovementStateMachine MovementState;
+
+	/** Seconds simulated since BeginPlay, the clock MovementState runs on */
+	float SimulationTime;
 
 protected:
 	// APawn interface
@@ -144,8 +327,14 @@ protected:
 	// End of APawn interface
 	virtual void Tick(float DeltaTime) override;
 
+	virtual void PostInitializeComponents() override;
+
 	virtual void BeginPlay() override;
 
+	virtual void Landed(const FHitResult& Hit) override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:
 	/** Returns CameraBoom subobject **/
 	FORCEINLINE class USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
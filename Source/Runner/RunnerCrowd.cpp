@@ -0,0 +1,181 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerCrowd.h"
+#include "Runner.h"
+#include "TrackObstacleRegistry.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+	/** xorshift32, State must not be zero */
+	uint32 NextRandom(uint32& State)
+	{
+		State ^= State << 13;
+		State ^= State >> 17;
+		State ^= State << 5;
+		return State;
+	}
+
+	float NextRandomFraction(uint32& State)
+	{
+		return (NextRandom(State) >> 8) * (1.0f / 16777216.0f);
+	}
+}
+
+void FRunnerCrowd::Init(int32 NumRunners, TArrayView<const float> InLaneOffsets, float StartDistance, float RowSpacing, int32 Seed)
+{
+	Reset();
+	LaneOffsets.Append(InLaneOffsets.GetData(), InLaneOffsets.Num());
+	if (LaneOffsets.Num() == 0)
+	{
+		LaneOffsets.Add(0.0f);
+	}
+	const int32 NumLanes = LaneOffsets.Num();
+
+	Distances.SetNumUninitialized(NumRunners);
+	Speeds.SetNumZeroed(NumRunners);
+	Laterals.SetNumUninitialized(NumRunners);
+	Heights.SetNumZeroed(NumRunners);
+	VerticalSpeeds.SetNumZeroed(NumRunners);
+	ShieldTimes.SetNumZeroed(NumRunners);
+	DecisionTimes.SetNumUninitialized(NumRunners);
+	Lanes.SetNumUninitialized(NumRunners);
+	RandomStates.SetNumUninitialized(NumRunners);
+	for (int32 Index = 0; Index < NumRunners; Index++)
+	{
+		const int32 Lane = Index % NumLanes;
+		Distances[Index] = StartDistance - (Index / NumLanes) * RowSpacing;
+		Laterals[Index] = LaneOffsets[Lane];
+		Lanes[Index] = uint8(Lane);
+		RandomStates[Index] = HashCombine(GetTypeHash(Seed), GetTypeHash(Index)) | 1u;
+		DecisionTimes[Index] = 1.0f + 3.0f * NextRandomFraction(RandomStates[Index]);
+	}
+}
+
+void FRunnerCrowd::Reset()
+{
+	LaneOffsets.Reset();
+	Distances.Reset();
+	Speeds.Reset();
+	Laterals.Reset();
+	Heights.Reset();
+	VerticalSpeeds.Reset();
+	ShieldTimes.Reset();
+	DecisionTimes.Reset();
+	Lanes.Reset();
+	RandomStates.Reset();
+	NumHits = 0;
+}
+
+void FRunnerCrowd::Step(float DeltaTime, const FRunnerCrowdParams& Params, const FTrackObstacleRegistry* Obstacles)
+{
+	const int32 BatchSize = FMath::Max(1, Params.BatchSize);
+	const int32 NumBatches = FMath::DivideAndRoundUp(Num(), BatchSize);
+	if (BatchScratch.Num() < NumBatches)
+	{
+		BatchScratch.SetNum(NumBatches);
+	}
+	ParallelFor(NumBatches, [this, BatchSize, DeltaTime, &Params, Obstacles](int32 Batch)
+	{
+		const int32 Begin = Batch * BatchSize;
+		StepRange(Begin, FMath::Min(Begin + BatchSize, Num()), DeltaTime, Params, Obstacles, BatchScratch[Batch]);
+	});
+}
+
+void FRunnerCrowd::StepRange(int32 Begin, int32 End, float DeltaTime, const FRunnerCrowdParams& Params, const FTrackObstacleRegistry* Obstacles, TArray<int32>& Scratch)
+{
+	int32 BatchHits = 0;
+	const int32 NumLanes = LaneOffsets.Num();
+	const float MaxLateralStep = Params.LaneChangeSpeed * DeltaTime;
+	for (int32 Index = Begin; Index < End; Index++)
+	{
+		ShieldTimes[Index] = FMath::Max(0.0f, ShieldTimes[Index] - DeltaTime);
+		Speeds[Index] = FMath::Min(Params.RunSpeed, Speeds[Index] + Params.Acceleration * DeltaTime);
+		Distances[Index] += Speeds[Index] * DeltaTime;
+
+		const bool bGrounded = Heights[Index] <= 0.0f && VerticalSpeeds[Index] <= 0.0f;
+		if (bGrounded)
+		{
+			const float LaneOffset = LaneOffsets[Lanes[Index]];
+			Scratch.Reset();
+			if (Obstacles != nullptr)
+			{
+				Obstacles->Query(Distances[Index], Distances[Index] + Params.LookAhead, LaneOffset - Params.Radius, LaneOffset + Params.Radius, Scratch);
+			}
+			if (Scratch.Num() > 0)
+			{
+				// Dodge into a clear lane if there is one, otherwise jump it
+				const int32 ClearLane = FindClearLane(Lanes[Index], Distances[Index], Params, *Obstacles, Scratch);
+				if (ClearLane != INDEX_NONE)
+				{
+					Lanes[Index] = uint8(ClearLane);
+				}
+				else
+				{
+					VerticalSpeeds[Index] = Params.JumpZVelocity;
+				}
+			}
+			else if ((DecisionTimes[Index] -= DeltaTime) <= 0.0f)
+			{
+				const int32 Shift = (NextRandom(RandomStates[Index]) & 1) ? 1 : -1;
+				Lanes[Index] = uint8(FMath::Clamp(Lanes[Index] + Shift, 0, NumLanes - 1));
+				DecisionTimes[Index] = 1.0f + 3.0f * NextRandomFraction(RandomStates[Index]);
+			}
+		}
+
+		const float Remaining = LaneOffsets[Lanes[Index]] - Laterals[Index];
+		Laterals[Index] += FMath::Clamp(Remaining, -MaxLateralStep, MaxLateralStep);
+
+		// Same closed-form arc as the runner's track movement
+		if (Heights[Index] > 0.0f || VerticalSpeeds[Index] > 0.0f)
+		{
+			Heights[Index] += VerticalSpeeds[Index] * DeltaTime + 0.5f * Params.GravityZ * DeltaTime * DeltaTime;
+			VerticalSpeeds[Index] += Params.GravityZ * DeltaTime;
+			if (Heights[Index] <= 0.0f)
+			{
+				Heights[Index] = 0.0f;
+				VerticalSpeeds[Index] = 0.0f;
+			}
+		}
+
+		if (Obstacles != nullptr && ShieldTimes[Index] <= 0.0f && Heights[Index] < Params.ClearHeight)
+		{
+			Scratch.Reset();
+			Obstacles->Query(Distances[Index] - Params.Radius, Distances[Index] + Params.Radius, Laterals[Index] - Params.Radius, Laterals[Index] + Params.Radius, Scratch);
+			if (Scratch.Num() > 0)
+			{
+				// Stumble: back to a standstill, shielded while getting going again
+				Speeds[Index] = 0.0f;
+				ShieldTimes[Index] = Params.ShieldTime;
+				BatchHits++;
+			}
+		}
+	}
+	if (BatchHits > 0)
+	{
+		FPlatformAtomics::InterlockedAdd(&NumHits, BatchHits);
+	}
+}
+
+int32 FRunnerCrowd::FindClearLane(int32 Lane, float Distance, const FRunnerCrowdParams& Params, const FTrackObstacleRegistry& Obstacles, TArray<int32>& Scratch) const
+{
+	for (int32 Offset = 1; Offset < LaneOffsets.Num(); Offset++)
+	{
+		for (const int32 Candidate : { Lane - Offset, Lane + Offset })
+		{
+			if (!LaneOffsets.IsValidIndex(Candidate))
+			{
+				continue;
+			}
+			Scratch.Reset();
+			const float LaneOffset = LaneOffsets[Candidate];
+			Obstacles.Query(Distance, Distance + Params.LookAhead, LaneOffset - Params.Radius, LaneOffset + Params.Radius, Scratch);
+			if (Scratch.Num() == 0)
+			{
+				return Candidate;
+			}
+		}
+	}
+	return INDEX_NONE;
+}
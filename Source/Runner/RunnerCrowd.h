@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FTrackObstacleRegistry;
+
+/** Tuning shared by every runner of a crowd, distances in cm */
+struct FRunnerCrowdParams
+{
+	float RunSpeed = 600.0f;
+
+	float Acceleration = 2048.0f;
+
+	float LaneChangeSpeed = 1500.0f;
+
+	float JumpZVelocity = 600.0f;
+
+	float GravityZ = -980.0f;
+
+	/** Height above the track at which a runner passes over obstacles */
+	float ClearHeight = 60.0f;
+
+	/** How far ahead a runner checks its lane for obstacles */
+	float LookAhead = 600.0f;
+
+	/** Half width of a runner in track space */
+	float Radius = 42.0f;
+
+	/** Protection after stumbling into an obstacle */
+	float ShieldTime = 2.0f;
+
+	/** Runners updated by one ParallelFor task */
+	int32 BatchSize = 256;
+};
+
+/**
+ * Bot runners stored as parallel arrays in track space: distance along the track, lateral offset,
+ * height of the jump arc and a shield timer. Each runner only reads shared data and writes its own
+ * slots, so Step splits them into batches across the task graph.
+ */
+class RUNNER_API FRunnerCrowd
+{
+public:
+	/** Lines NumRunners up in rows behind StartDistance, one runner per lane in each row */
+	void Init(int32 NumRunners, TArrayView<const float> InLaneOffsets, float StartDistance, float RowSpacing, int32 Seed);
+
+	void Reset();
+
+	/** Advances every runner by DeltaTime; without Obstacles the track is treated as clear */
+	void Step(float DeltaTime, const FRunnerCrowdParams& Params, const FTrackObstacleRegistry* Obstacles);
+
+	int32 Num() const { return Distances.Num(); }
+
+	float GetDistance(int32 Index) const { return Distances[Index]; }
+
+	float GetLateral(int32 Index) const { return Laterals[Index]; }
+
+	float GetHeight(int32 Index) const { return Heights[Index]; }
+
+	float GetSpeed(int32 Index) const { return Speeds[Index]; }
+
+	bool IsShielded(int32 Index) const { return ShieldTimes[Index] > 0.0f; }
+
+	/** Times a runner ran into an obstacle unshielded since Init */
+	int32 GetNumHits() const { return NumHits; }
+
+private:
+	void StepRange(int32 Begin, int32 End, float DeltaTime, const FRunnerCrowdParams& Params, const FTrackObstacleRegistry* Obstacles, TArray<int32>& Scratch);
+
+	/** Closest lane to Lane with nothing in the look-ahead window, INDEX_NONE if there is none */
+	int32 FindClearLane(int32 Lane, float Distance, const FRunnerCrowdParams& Params, const FTrackObstacleRegistry& Obstacles, TArray<int32>& Scratch) const;
+
+	TArray<float> LaneOffsets;
+
+	TArray<float> Distances;
+
+	TArray<float> Speeds;
+
+	TArray<float> Laterals;
+
+	TArray<float> Heights;
+
+	TArray<float> VerticalSpeeds;
+
+	TArray<float> ShieldTimes;
+
+	/** Seconds until the runner considers a lane change of its own accord */
+	TArray<float> DecisionTimes;
+
+	TArray<uint8> Lanes;
+
+	/** Per-runner random state, so batches never share a generator */
+	TArray<uint32> RandomStates;
+
+	/** Query results of each batch, kept between steps so workers never allocate */
+	TArray<TArray<int32>> BatchScratch;
+
+	int32 NumHits = 0;
+};
@@ -0,0 +1,382 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerCrowdSubsystem.h"
+#include "Runner.h"
+#include "RunnerCharacter.h"
+#include "RunnerGameMode.h"
+#include "RunnerPreloadSubsystem.h"
+#include "TrackCollisionSubsystem.h"
+#include "TrackGeneratorComponent.h"
+#include "Algo/BinarySearch.h"
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/PlatformMisc.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/CommandLine.h"
+
+namespace
+{
+	/** Where runners off the live track wait, scaled to nothing so they are never drawn */
+	const FTransform ParkedTransform(FQuat::Identity, FVector(0.0f, 0.0f, -100000.0f), FVector::ZeroVector);
+}
+
+void URunnerCrowdSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	PendingRunners = GetDesiredRunners();
+}
+
+int32 URunnerCrowdSubsystem::GetDesiredRunners() const
+{
+	int32 NumRunners = 0;
+	if (FParse::Value(FCommandLine::Get(), TEXT("Crowd="), NumRunners))
+	{
+		return FMath::Clamp(NumRunners, 0, MaxRunners);
+	}
+	if (bEnableCrowd || FParse::Param(FCommandLine::Get(), TEXT("Crowd")))
+	{
+		return FMath::Min(RunnersPerCore * FPlatformMisc::NumberOfCoresIncludingHyperthreads(), MaxRunners);
+	}
+	return 0;
+}
+
+void URunnerCrowdSubsystem::Start(int32 NumRunners)
+{
+	PendingRunners = 0;
+	ARunnerCharacter* Runner = Cast<ARunnerCharacter>(UGameplayStatics::GetPlayerCharacter(this, 0));
+	if (Runner == nullptr || NumRunners <= 0)
+	{
+		return;
+	}
+
+	// Bots move like the player's runner
+	const UCharacterMovementComponent* Movement = Runner->GetCharacterMovement();
+	Params.RunSpeed = RunSpeed;
+	Params.Acceleration = Movement->GetMaxAcceleration();
+	Params.JumpZVelocity = Movement->JumpZVelocity;
+	Params.GravityZ = Movement->GetGravityZ();
+	Params.LaneChangeSpeed = Runner->LaneChangeSpeed;
+	Params.Radius = Runner->GetCapsuleComponent()->GetScaledCapsuleRadius();
+	Params.LookAhead = LookAhead;
+	Params.ClearHeight = ClearHeight;
+	Params.BatchSize = FMath::Max(1, BatchSize);
+
+	const FRunnerLaneSystem& Lanes = Runner->GetLaneSystem();
+	TArray<float, TInlineAllocator<8>> LaneOffsets;
+	for (int32 Lane = 0; Lane < Lanes.GetNumLanes(); Lane++)
+	{
+		LaneOffsets.Add(Lanes.GetLaneOffset(Lane));
+	}
+
+	ARunnerGameMode* GameMode = GetWorld()->GetAuthGameMode<ARunnerGameMode>();
+	TrackGenerator = GameMode ? GameMode->TrackGenerator : nullptr;
+	const int32 Seed = TrackGenerator.IsValid() ? TrackGenerator->Seed : 0;
+	TrackOrigin = FTransform(FRotator(0.0f, Runner->GetControlRotation().Yaw, 0.0f), Runner->GetActorLocation() - FVector(0.0f, 0.0f, Runner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight()));
+	float StartDistance = 0.0f;
+	float StartLateral = 0.0f;
+	if (!TrackGenerator.IsValid() || !TrackGenerator->FindTrackLocation(Runner->GetActorLocation(), StartDistance, StartLateral))
+	{
+		TrackGenerator = nullptr;
+		StartDistance = 0.0f;
+	}
+
+	Crowd.Init(NumRunners, LaneOffsets, StartDistance - RowSpacing, RowSpacing, Seed);
+	InstanceTransforms.Init(ParkedTransform, NumRunners);
+	OnTrack.Init(0, NumRunners);
+	Shielded.Init(0, NumRunners);
+	Drawn.Init(0, NumRunners);
+	InstanceDirty.Init(0, NumRunners);
+	SortedRunners.Reset();
+	SortedDistances.Reset();
+	StepSeconds = 0.0;
+	NumRunnerSteps = 0;
+	NumSteps = 0;
+	CreateInstances(NumRunners);
+	UE_LOG(LogRunner, Log, TEXT("Started a crowd of %d runners in batches of %d"), NumRunners, Params.BatchSize);
+}
+
+void URunnerCrowdSubsystem::CreateInstances(int32 NumRunners)
+{
+	if (CrowdActor != nullptr)
+	{
+		CrowdActor->Destroy();
+		CrowdActor = nullptr;
+		Instances = nullptr;
+	}
+	UStaticMesh* Mesh = CrowdMesh.IsValid() ? Cast<UStaticMesh>(URunnerPreloadSubsystem::Resolve(CrowdMesh)) : nullptr;
+	if (Mesh == nullptr)
+	{
+		UE_LOG(LogRunner, Warning, TEXT("CrowdMesh %s is not a static mesh, the crowd of %d runners is simulated but not drawn"), CrowdMesh.IsValid() ? *CrowdMesh.ToString() : TEXT("(unset)"), NumRunners);
+		return;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	CrowdActor = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+	Instances = NewObject<UInstancedStaticMeshComponent>(CrowdActor);
+	CrowdActor->SetRootComponent(Instances);
+	Instances->SetMobility(EComponentMobility::Movable);
+	Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Instances->SetCanEverAffectNavigation(false);
+	Instances->SetStaticMesh(Mesh);
+	Instances->NumCustomDataFloats = int32(ERunnerCrowdInstanceData::Num);
+	Instances->RegisterComponent();
+	Instances->AddInstances(InstanceTransforms, false, true);
+
+	FRandomStream Phases(NumRunners);
+	for (int32 Index = 0; Index < NumRunners; Index++)
+	{
+		Instances->SetCustomDataValue(Index, int32(ERunnerCrowdInstanceData::AnimationPhase), Phases.GetFraction(), false);
+	}
+	Instances->MarkRenderStateDirty();
+}
+
+bool URunnerCrowdSubsystem::FindTrackDistance(const FVector& Location, float& OutDistance) const
+{
+	if (const UTrackGeneratorComponent* Generator = TrackGenerator.Get())
+	{
+		float Lateral = 0.0f;
+		return Generator->FindTrackLocation(Location, OutDistance, Lateral);
+	}
+	OutDistance = TrackOrigin.InverseTransformPositionNoScale(Location).X;
+	return true;
+}
+
+bool URunnerCrowdSubsystem::FindNearestRunner(const FVector& From, FVector& OutLocation, FVector& OutVelocity) const
+{
+	float FromDistance = 0.0f;
+	if (SortedRunners.Num() == 0 || !FindTrackDistance(From, FromDistance))
+	{
+		return false;
+	}
+
+	// Walk outwards from From's place in the crowd; a runner further along the track than the best
+	// one is away in a straight line cannot be closer, short of the track doubling back on itself
+	int32 Nearest = INDEX_NONE;
+	float NearestDistanceSquared = TNumericLimits<float>::Max();
+	int32 Ahead = Algo::LowerBound(SortedDistances, FromDistance);
+	int32 Behind = Ahead - 1;
+	while (Behind >= 0 || Ahead < SortedRunners.Num())
+	{
+		const float AheadGap = Ahead < SortedRunners.Num() ? SortedDistances[Ahead] - FromDistance : TNumericLimits<float>::Max();
+		const float BehindGap = Behind >= 0 ? FromDistance - SortedDistances[Behind] : TNumericLimits<float>::Max();
+		const float Gap = FMath::Min(AheadGap, BehindGap);
+		if (Nearest != INDEX_NONE && Gap * Gap >= NearestDistanceSquared)
+		{
+			break;
+		}
+		const int32 Index = AheadGap <= BehindGap ? SortedRunners[Ahead++] : SortedRunners[Behind--];
+		if (!OnTrack[Index])
+		{
+			continue;
+		}
+		const float DistanceSquared = FVector::DistSquared(From, InstanceTransforms[Index].GetLocation());
+		if (DistanceSquared < NearestDistanceSquared)
+		{
+			NearestDistanceSquared = DistanceSquared;
+			Nearest = Index;
+		}
+	}
+	if (Nearest == INDEX_NONE)
+	{
+		return false;
+	}
+	OutLocation = InstanceTransforms[Nearest].GetLocation();
+	OutVelocity = InstanceTransforms[Nearest].GetRotation().GetForwardVector() * Crowd.GetSpeed(Nearest);
+	return true;
+}
+
+double URunnerCrowdSubsystem::GetRunnersPerMillisecond() const
+{
+	return StepSeconds > 0.0 ? NumRunnerSteps / (StepSeconds * 1000.0) : 0.0;
+}
+
+double URunnerCrowdSubsystem::GetAverageStepMilliseconds() const
+{
+	return NumSteps > 0 ? StepSeconds * 1000.0 / NumSteps : 0.0;
+}
+
+void URunnerCrowdSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	if (PendingRunners > 0 && UGameplayStatics::GetPlayerCharacter(this, 0) != nullptr)
+	{
+		Start(PendingRunners);
+	}
+	if (Crowd.Num() == 0)
+	{
+		return;
+	}
+	SCOPE_CYCLE_COUNTER(STAT_RunnerCrowd);
+
+	const UTrackCollisionSubsystem* Collision = GetWorld()->GetSubsystem<UTrackCollisionSubsystem>();
+	const FTrackObstacleRegistry* Obstacles = (Collision && Collision->IsEnabled() && TrackGenerator.IsValid()) ? &Collision->GetObstacles() : nullptr;
+	const double StepStart = FPlatformTime::Seconds();
+	Crowd.Step(DeltaTime, Params, Obstacles);
+	StepSeconds += FPlatformTime::Seconds() - StepStart;
+	NumRunnerSteps += Crowd.Num();
+	NumSteps++;
+
+	UpdateInstances();
+	SortRunners();
+	RUNNER_SET_COUNTER(RunnerCrowdRunners, Crowd.Num());
+}
+
+void URunnerCrowdSubsystem::SortRunners()
+{
+	const int32 NumRunners = Crowd.Num();
+	if (SortedRunners.Num() != NumRunners)
+	{
+		SortedRunners.SetNumUninitialized(NumRunners);
+		for (int32 Index = 0; Index < NumRunners; Index++)
+		{
+			SortedRunners[Index] = Index;
+		}
+		Algo::SortBy(SortedRunners, [this](int32 Index) { return Crowd.GetDistance(Index); });
+	}
+	else
+	{
+		// Runners rarely pass each other within a step, so last step's order is nearly sorted
+		// and an insertion sort over it is close to linear
+		for (int32 Sorted = 1; Sorted < NumRunners; Sorted++)
+		{
+			const int32 Index = SortedRunners[Sorted];
+			const float Distance = Crowd.GetDistance(Index);
+			int32 Slot = Sorted;
+			for (; Slot > 0 && Crowd.GetDistance(SortedRunners[Slot - 1]) > Distance; Slot--)
+			{
+				SortedRunners[Slot] = SortedRunners[Slot - 1];
+			}
+			SortedRunners[Slot] = Index;
+		}
+	}
+
+	SortedDistances.SetNumUninitialized(NumRunners);
+	for (int32 Sorted = 0; Sorted < NumRunners; Sorted++)
+	{
+		SortedDistances[Sorted] = Crowd.GetDistance(SortedRunners[Sorted]);
+	}
+}
+
+bool URunnerCrowdSubsystem::GetView(FVector& OutOrigin, FVector& OutDirection, float& OutCosHalfAngle) const
+{
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	const APlayerCameraManager* CameraManager = PlayerController ? PlayerController->PlayerCameraManager : nullptr;
+	if (CameraManager == nullptr)
+	{
+		return false;
+	}
+	const FMinimalViewInfo& View = CameraManager->GetCameraCacheView();
+	OutDirection = View.Rotation.Vector();
+	// Pulled back so runners straddling the edge of the view or right beside the camera still count
+	OutOrigin = View.Location - OutDirection * Params.Radius * 4.0f;
+	// The cone has to reach the corners of the view, whichever way round the screen is
+	const float TanHorizontal = FMath::Tan(FMath::DegreesToRadians(FMath::Clamp(View.FOV, 1.0f, 170.0f) * 0.5f));
+	const float TanVertical = TanHorizontal / FMath::Max(View.AspectRatio, 0.1f);
+	OutCosHalfAngle = 1.0f / FMath::Sqrt(1.0f + TanHorizontal * TanHorizontal + TanVertical * TanVertical);
+	return true;
+}
+
+void URunnerCrowdSubsystem::UpdateInstances()
+{
+	const UTrackGeneratorComponent* Generator = TrackGenerator.Get();
+	FVector ViewOrigin = FVector::ZeroVector;
+	FVector ViewDirection = FVector::ForwardVector;
+	float CosHalfAngle = -1.0f;
+	// Without a camera, e.g. in the benchmark, every runner counts as in view
+	const bool bHasView = Instances != nullptr && GetView(ViewOrigin, ViewDirection, CosHalfAngle);
+	const float DrawDistanceSquared = FMath::Square(DrawDistance);
+	const int32 NumBatches = FMath::DivideAndRoundUp(Crowd.Num(), Params.BatchSize);
+	ParallelFor(NumBatches, [this, Generator, bHasView, ViewOrigin, ViewDirection, CosHalfAngle, DrawDistanceSquared](int32 Batch)
+	{
+		const int32 Begin = Batch * Params.BatchSize;
+		const int32 End = FMath::Min(Begin + Params.BatchSize, Crowd.Num());
+		for (int32 Index = Begin; Index < End; Index++)
+		{
+			FVector Location;
+			float Yaw = 0.0f;
+			bool bOnTrack = true;
+			if (Generator != nullptr)
+			{
+				bOnTrack = Generator->FindWorldLocation(Crowd.GetDistance(Index), Crowd.GetLateral(Index), Location, Yaw);
+			}
+			else
+			{
+				Location = TrackOrigin.TransformPositionNoScale(FVector(Crowd.GetDistance(Index), Crowd.GetLateral(Index), 0.0f));
+				Yaw = TrackOrigin.Rotator().Yaw;
+			}
+			const FTransform Transform = bOnTrack ? FTransform(FRotator(0.0f, Yaw, 0.0f), Location + FVector(0.0f, 0.0f, Crowd.GetHeight(Index))) : ParkedTransform;
+			const bool bMoved = !Transform.Equals(InstanceTransforms[Index], KINDA_SMALL_NUMBER);
+			OnTrack[Index] = bOnTrack;
+			InstanceTransforms[Index] = Transform;
+
+			bool bInView = bOnTrack;
+			if (bInView && bHasView)
+			{
+				const FVector ToRunner = Transform.GetLocation() - ViewOrigin;
+				const float DistanceSquared = ToRunner.SizeSquared();
+				bInView = DistanceSquared <= DrawDistanceSquared && (ToRunner | ViewDirection) >= FMath::Sqrt(DistanceSquared) * CosHalfAngle;
+			}
+			// Runners out of view are parked once and then left alone until they come back
+			InstanceDirty[Index] = bInView ? (bMoved || !Drawn[Index]) : Drawn[Index];
+			Drawn[Index] = bInView;
+		}
+	});
+
+	if (Instances == nullptr)
+	{
+		return;
+	}
+	bool bChanged = false;
+	for (int32 Index = 0; Index < Crowd.Num(); Index++)
+	{
+		const uint8 bShielded = Crowd.IsShielded(Index);
+		if (Shielded[Index] != bShielded)
+		{
+			Shielded[Index] = bShielded;
+			Instances->SetCustomDataValue(Index, int32(ERunnerCrowdInstanceData::Shield), bShielded ? 1.0f : 0.0f, false);
+			bChanged = true;
+		}
+	}
+
+	// Rewrite each contiguous run of dirty instances in one call, and the render state only once
+	for (int32 Begin = 0; Begin < Crowd.Num(); )
+	{
+		if (!InstanceDirty[Begin])
+		{
+			Begin++;
+			continue;
+		}
+		DrawScratch.Reset();
+		int32 End = Begin;
+		for (; End < Crowd.Num() && InstanceDirty[End]; End++)
+		{
+			DrawScratch.Add(Drawn[End] ? CrowdMeshTransform * InstanceTransforms[End] : ParkedTransform);
+		}
+		Instances->BatchUpdateInstancesTransforms(Begin, DrawScratch, true, false, true);
+		bChanged = true;
+		Begin = End;
+	}
+	if (bChanged)
+	{
+		Instances->MarkRenderStateDirty();
+	}
+}
+
+TStatId URunnerCrowdSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URunnerCrowdSubsystem, STATGROUP_Tickables);
+}
+
+bool URunnerCrowdSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,168 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RunnerCrowd.h"
+#include "RunnerCrowdSubsystem.generated.h"
+
+class UInstancedStaticMeshComponent;
+class UTrackGeneratorComponent;
+
+/** Per-instance custom data of crowd instances, read by the crowd material with PerInstanceCustomData */
+enum class ERunnerCrowdInstanceData : uint8
+{
+	/** 1 while the runner is shielded */
+	Shield = 0,
+	/** Offset into the vertex animation so the crowd does not run in step */
+	AnimationPhase = 1,
+	Num
+};
+
+/**
+ * Bot runners for load testing and ghost races. Runners live in an FRunnerCrowd in track space,
+ * are stepped across worker threads and drawn as one instanced vertex-animated mesh. Enemies aim
+ * at whichever runner is closest, the player's or a bot, but only the player's runner engages them.
+ *
+ * The crowd starts once the player's runner exists, sized by -Crowd=N, or by RunnersPerCore times
+ * the core count when bEnableCrowd is set or -Crowd is passed without a count.
+ */
+UCLASS(config=Game)
+class RUNNER_API URunnerCrowdSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	/** Replaces the crowd with NumRunners bots lined up behind the player's runner */
+	void Start(int32 NumRunners);
+
+	int32 GetNumRunners() const { return Crowd.Num(); }
+
+	/**
+	 * Closest bot on the live track to From, false if there is none or From is off the track.
+	 * Only looks as far along the track as the best runner found so far.
+	 */
+	bool FindNearestRunner(const FVector& From, FVector& OutLocation, FVector& OutVelocity) const;
+
+	/** Runner updates per millisecond of FRunnerCrowd::Step since Start */
+	double GetRunnersPerMillisecond() const;
+
+	double GetAverageStepMilliseconds() const;
+
+	int32 GetNumHits() const { return Crowd.GetNumHits(); }
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Count asked for on the command line or in config, 0 for no crowd */
+	int32 GetDesiredRunners() const;
+
+	void CreateInstances(int32 NumRunners);
+
+	/**
+	 * Moves the instances of runners in view that moved to their place on the track, and parks those
+	 * that left the view or the live track. Everything else keeps last frame's instance data.
+	 */
+	void UpdateInstances();
+
+	/** Cone around the player's camera that UpdateInstances draws, false when there is no camera */
+	bool GetView(FVector& OutOrigin, FVector& OutDirection, float& OutCosHalfAngle) const;
+
+	/** Brings SortedRunners up to date with this step's distances */
+	void SortRunners();
+
+	/** Distance along the track the crowd runs on */
+	bool FindTrackDistance(const FVector& Location, float& OutDistance) const;
+
+	UPROPERTY(Config)
+	bool bEnableCrowd = false;
+
+	UPROPERTY(Config)
+	int32 RunnersPerCore = 128;
+
+	UPROPERTY(Config)
+	int32 MaxRunners = 8192;
+
+	/** Track distance between rows of runners at the start */
+	UPROPERTY(Config)
+	float RowSpacing = 150.0f;
+
+	UPROPERTY(Config)
+	float RunSpeed = 600.0f;
+
+	UPROPERTY(Config)
+	float LookAhead = 600.0f;
+
+	UPROPERTY(Config)
+	float ClearHeight = 60.0f;
+
+	/** Runners per ParallelFor task */
+	UPROPERTY(Config)
+	int32 BatchSize = 256;
+
+	/** Vertex-animated runner mesh; without one the crowd still runs but is not drawn */
+	UPROPERTY(Config)
+	FSoftObjectPath CrowdMesh;
+
+	/** Placement of CrowdMesh relative to a runner's feet, for meshes not authored as a runner */
+	UPROPERTY(Config)
+	FTransform CrowdMeshTransform;
+
+	/** Runners further than this from the camera are parked instead of drawn */
+	UPROPERTY(Config)
+	float DrawDistance = 15000.0f;
+
+	/** Runners waiting for the player's runner to exist before they start */
+	int32 PendingRunners = 0;
+
+	FRunnerCrowd Crowd;
+
+	FRunnerCrowdParams Params;
+
+	TWeakObjectPtr<UTrackGeneratorComponent> TrackGenerator;
+
+	/** Straight track the crowd runs along when there is no generated one */
+	FTransform TrackOrigin;
+
+	/** World transform of each runner as of the last update */
+	TArray<FTransform> InstanceTransforms;
+
+	/** Whether each runner was on a live tile at the last update */
+	TArray<uint8> OnTrack;
+
+	TArray<uint8> Shielded;
+
+	/** Whether each runner's instance shows it rather than being parked */
+	TArray<uint8> Drawn;
+
+	/** Whether each runner's instance has to be rewritten this update */
+	TArray<uint8> InstanceDirty;
+
+	/** Instance transforms of one contiguous run of dirty runners */
+	TArray<FTransform> DrawScratch;
+
+	/** Runner indices in order of track distance */
+	TArray<int32> SortedRunners;
+
+	/** Track distance of each entry of SortedRunners */
+	TArray<float> SortedDistances;
+
+	UPROPERTY()
+	AActor* CrowdActor;
+
+	UPROPERTY()
+	UInstancedStaticMeshComponent* Instances;
+
+	double StepSeconds = 0.0;
+
+	int64 NumRunnerSteps = 0;
+
+	int32 NumSteps = 0;
+};
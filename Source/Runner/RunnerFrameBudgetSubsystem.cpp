@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerFrameBudgetSubsystem.h"
+#include "Runner.h"
+#include "Engine/World.h"
+
+void URunnerFrameBudgetSubsystem::Enqueue(ERunnerWorkPriority Priority, const UObject* Owner, TFunction<void()>&& Work)
+{
+	if (!bDeferWork)
+	{
+		Work();
+		return;
+	}
+	FRunnerDeferredWork& Item = Queues[(int32)Priority].AddDefaulted_GetRef();
+	Item.Owner = Owner;
+	Item.Work = MoveTemp(Work);
+}
+
+void URunnerFrameBudgetSubsystem::Defer(const UObject* Owner, ERunnerWorkPriority Priority, TFunction<void()>&& Work)
+{
+	UWorld* World = Owner ? Owner->GetWorld() : nullptr;
+	if (URunnerFrameBudgetSubsystem* Scheduler = World ? World->GetSubsystem<URunnerFrameBudgetSubsystem>() : nullptr)
+	{
+		Scheduler->Enqueue(Priority, Owner, MoveTemp(Work));
+		return;
+	}
+	Work();
+}
+
+void URunnerFrameBudgetSubsystem::Flush()
+{
+	while (RunNext())
+	{
+	}
+}
+
+int32 URunnerFrameBudgetSubsystem::GetNumQueued() const
+{
+	int32 NumQueued = 0;
+	for (int32 Priority = 0; Priority < (int32)ERunnerWorkPriority::Num; Priority++)
+	{
+		NumQueued += Queues[Priority].Num() - QueueHeads[Priority];
+	}
+	return NumQueued;
+}
+
+void URunnerFrameBudgetSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	SCOPE_CYCLE_COUNTER(STAT_RunnerFrameBudget);
+	const double StartTime = FPlatformTime::Seconds();
+	const double Budget = BudgetMilliseconds / 1000.0;
+	int32 NumRun = 0;
+	while (NumRun < MinItemsPerFrame || FPlatformTime::Seconds() - StartTime < Budget)
+	{
+		if (!RunNext())
+		{
+			break;
+		}
+		NumRun++;
+	}
+
+	const double Elapsed = FPlatformTime::Seconds() - StartTime;
+	if (Elapsed > Budget)
+	{
+		NumOverruns++;
+		UE_LOG(LogRunner, Verbose, TEXT("Deferred work took %.2f ms for %d items, budget is %.2f ms"), Elapsed * 1000.0, NumRun, BudgetMilliseconds);
+	}
+	RUNNER_SET_COUNTER(RunnerWorkQueued, GetNumQueued());
+	RUNNER_SET_COUNTER(RunnerWorkOverruns, NumOverruns);
+}
+
+bool URunnerFrameBudgetSubsystem::RunNext()
+{
+	for (int32 Priority = 0; Priority < (int32)ERunnerWorkPriority::Num; Priority++)
+	{
+		TArray<FRunnerDeferredWork>& Queue = Queues[Priority];
+		int32& Head = QueueHeads[Priority];
+		if (Head == Queue.Num())
+		{
+			continue;
+		}
+
+		// Move the item out first, the work may queue more
+		FRunnerDeferredWork Item = MoveTemp(Queue[Head]);
+		Head++;
+		if (Head == Queue.Num())
+		{
+			Queue.Reset();
+			Head = 0;
+		}
+		else if (Head >= 64 && Head * 2 >= Queue.Num())
+		{
+			Queue.RemoveAt(0, Head, false);
+			Head = 0;
+		}
+		if (Item.Owner.IsValid() || Item.Owner.IsExplicitlyNull())
+		{
+			Item.Work();
+		}
+		return true;
+	}
+	return false;
+}
+
+TStatId URunnerFrameBudgetSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URunnerFrameBudgetSubsystem, STATGROUP_Tickables);
+}
+
+bool URunnerFrameBudgetSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RunnerFrameBudgetSubsystem.generated.h"
+
+/** Order deferred work is run in, High first */
+enum class ERunnerWorkPriority : uint8
+{
+	/** Visible soon, e.g. re-arming enemies on a tile the runner is approaching */
+	High,
+	/** Reactions that can trail the event by a frame or two */
+	Normal,
+	/** Warm-up nobody is waiting for yet */
+	Low,
+	Num
+};
+
+/** One queued piece of work, dropped if its owner is gone by the time it runs */
+struct FRunnerDeferredWork
+{
+	TWeakObjectPtr<const UObject> Owner;
+
+	TFunction<void()> Work;
+};
+
+/**
+ * Spreads heavy but deferrable gameplay work over frames. Work is queued by priority and run at the
+ * end of the frame until the per-frame budget is spent, so a burst such as entering a cluster of
+ * enemies costs a few milliseconds over several frames instead of one long frame.
+ */
+UCLASS(config=Game)
+class RUNNER_API URunnerFrameBudgetSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Queues Work, or runs it straight away when deferral is off */
+	void Enqueue(ERunnerWorkPriority Priority, const UObject* Owner, TFunction<void()>&& Work);
+
+	/** Queues Work on the world's scheduler, running it inline if the world has none */
+	static void Defer(const UObject* Owner, ERunnerWorkPriority Priority, TFunction<void()>&& Work);
+
+	/** Runs every queued item regardless of the budget */
+	void Flush();
+
+	int32 GetNumQueued() const;
+
+	/** Frames whose work went over the budget since the world started */
+	int32 GetNumOverruns() const { return NumOverruns; }
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Pops and runs the oldest item of the highest priority, false when nothing is queued */
+	bool RunNext();
+
+	/** Milliseconds of deferred work allowed per frame */
+	UPROPERTY(Config)
+	float BudgetMilliseconds = 2.0f;
+
+	/** Items run each frame even when one of them alone used up the budget */
+	UPROPERTY(Config)
+	int32 MinItemsPerFrame = 1;
+
+	/** Off: everything runs inline at the call site, for comparing frame times */
+	UPROPERTY(Config)
+	bool bDeferWork = true;
+
+	/** FIFO per priority, consumed from QueueHeads */
+	TArray<FRunnerDeferredWork> Queues[(int32)ERunnerWorkPriority::Num];
+
+	int32 QueueHeads[(int32)ERunnerWorkPriority::Num] = {};
+
+	int32 NumOverruns = 0;
+};
@@ -1,15 +1,93 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "RunnerGameMode.h"
+#include "Runner.h"
 #include "RunnerCharacter.h"
-#include "UObject/ConstructorHelpers.h"
+#include "RunnerPreloadSubsystem.h"
+#include "TrackGeneratorComponent.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Kismet/GameplayStatics.h"
+#include "TimerManager.h"
 
 ARunnerGameMode::ARunnerGameMode()
 {
-	// set default pawn class to our Blueprinted character
-	static ConstructorHelpers::FClassFinder<APawn> PlayerPawnBPClass(TEXT("/Game/ThirdPersonCPP/Blueprints/ThirdPersonCharacter"));
-	if (PlayerPawnBPClass.Class != NULL)
+	// set default pawn class to our Blueprinted character, streamed in by InitGame
+	RunnerPawnClass = TSoftClassPtr<APawn>(FSoftObjectPath(TEXT("/Game/ThirdPersonCPP/Blueprints/ThirdPersonCharacter.ThirdPersonCharacter_C")));
+	bStartupAssetsLoaded = false;
+
+	TrackGenerator = CreateDefaultSubobject<UTrackGeneratorComponent>(TEXT("TrackGenerator"));
+}
+
+void ARunnerGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+	URunnerPreloadSubsystem* Preload = GetGameInstance() ? GetGameInstance()->GetSubsystem<URunnerPreloadSubsystem>() : nullptr;
+	if (Preload == nullptr || RunnerPawnClass.IsNull())
+	{
+		OnStartupAssetsLoaded();
+		return;
+	}
+	PawnClassHandle = Preload->RequestAsyncLoad({ RunnerPawnClass.ToSoftObjectPath() }, FStreamableManager::AsyncLoadHighPriority, FStreamableDelegate::CreateUObject(this, &ARunnerGameMode::OnPawnClassLoaded));
+	if (!PawnClassHandle.IsValid())
+	{
+		OnPawnClassLoaded();
+	}
+}
+
+bool ARunnerGameMode::PlayerCanRestart_Implementation(APlayerController* Player)
+{
+	return bStartupAssetsLoaded && Super::PlayerCanRestart_Implementation(Player);
+}
+
+void ARunnerGameMode::RunnerDied(ARunnerCharacter* Runner)
+{
+	UE_LOG(LogRunner, Log, TEXT("Game over, %s died"), *GetNameSafe(Runner));
+	OnRunnerDied.Broadcast(Runner);
+	if (RestartDelay > 0.0f && !GetWorldTimerManager().IsTimerActive(RestartTimerHandle))
+	{
+		GetWorldTimerManager().SetTimer(RestartTimerHandle, this, &ARunnerGameMode::RestartRun, RestartDelay, false);
+	}
+}
+
+void ARunnerGameMode::RestartRun()
+{
+	GetWorldTimerManager().ClearTimer(RestartTimerHandle);
+	// A new world regenerates the track and resets every subsystem along with it
+	UGameplayStatics::OpenLevel(this, FName(*UGameplayStatics::GetCurrentLevelName(this)));
+}
+
+void ARunnerGameMode::OnPawnClassLoaded()
+{
+	URunnerPreloadSubsystem* Preload = GetGameInstance() ? GetGameInstance()->GetSubsystem<URunnerPreloadSubsystem>() : nullptr;
+	if (Preload == nullptr)
+	{
+		OnStartupAssetsLoaded();
+		return;
+	}
+	Preload->CallWhenManifestLoaded(FSimpleDelegate::CreateUObject(this, &ARunnerGameMode::OnStartupAssetsLoaded));
+}
+
+void ARunnerGameMode::OnStartupAssetsLoaded()
+{
+	if (UClass* PawnClass = RunnerPawnClass.Get())
+	{
+		DefaultPawnClass = PawnClass;
+	}
+	else if (!RunnerPawnClass.IsNull())
+	{
+		UE_LOG(LogRunner, Warning, TEXT("Could not load runner pawn %s"), *RunnerPawnClass.ToString());
+	}
+	bStartupAssetsLoaded = true;
+
+	// Players that joined while loading were turned away by PlayerCanRestart
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
 	{
-		DefaultPawnClass = PlayerPawnBPClass.Class;
+		APlayerController* PlayerController = It->Get();
+		if (PlayerController != nullptr && PlayerController->GetPawn() == nullptr && PlayerCanRestart(PlayerController))
+		{
+			RestartPlayer(PlayerController);
+		}
 	}
 }
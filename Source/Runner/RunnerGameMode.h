@@ -4,8 +4,13 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
+#include "Engine/StreamableManager.h"
 #include "RunnerGameMode.generated.h"
 
+class ARunnerCharacter;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FRunnerDiedSignature, ARunnerCharacter*, Runner);
+
 UCLASS(minimalapi)
 class ARunnerGameMode : public AGameModeBase
 {
@@ -13,6 +18,45 @@ class ARunnerGameMode : public AGameModeBase
 
 public:
 	ARunnerGameMode();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+
+	/** Holds players back until the runner pawn and the preload manifest are in */
+	virtual bool PlayerCanRestart_Implementation(APlayerController* Player) override;
+
+	/** Streams the course in front of the runner */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Track)
+	class UTrackGeneratorComponent* TrackGenerator;
+
+	/** Pawn spawned for players, loaded asynchronously instead of with the game mode */
+	UPROPERTY(EditDefaultsOnly, Category = Classes)
+	TSoftClassPtr<APawn> RunnerPawnClass;
+
+	/** Game over: tells listeners such as the game over screen, then restarts after RestartDelay */
+	void RunnerDied(ARunnerCharacter* Runner);
+
+	/** Starts a fresh run by reloading the current map */
+	UFUNCTION(BlueprintCallable, Category = Game)
+	void RestartRun();
+
+	/** Broadcast when a runner dies and the run is over */
+	UPROPERTY(BlueprintAssignable, Category = Game)
+	FRunnerDiedSignature OnRunnerDied;
+
+	/** Seconds from the runner dying to the run restarting, zero leaves the restart to RestartRun */
+	UPROPERTY(EditDefaultsOnly, Category = Game)
+	float RestartDelay = 3.0f;
+
+protected:
+	void OnPawnClassLoaded();
+
+	void OnStartupAssetsLoaded();
+
+	TSharedPtr<FStreamableHandle> PawnClassHandle;
+
+	bool bStartupAssetsLoaded;
+
+	FTimerHandle RestartTimerHandle;
 };
 
 
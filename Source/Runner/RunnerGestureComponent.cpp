@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerGestureComponent.h"
+#include "Runner.h"
+#include "RunnerCharacter.h"
+#include "Engine/Engine.h"
+#include "Engine/GameViewportClient.h"
+#include "Engine/UserInterfaceSettings.h"
+#include "Engine/World.h"
+
+URunnerGestureComponent::URunnerGestureComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	NumSamples = 0;
+	NextSample = 0;
+	StartLocation = FVector2D::ZeroVector;
+	ActiveFinger = INDEX_NONE;
+	bCommitted = false;
+	DPIScale = 1.0f;
+}
+
+void URunnerGestureComponent::TouchBegin(ETouchIndex::Type FingerIndex, const FVector2D& Location)
+{
+	if (ActiveFinger != INDEX_NONE)
+	{
+		return;
+	}
+	ActiveFinger = FingerIndex;
+	bCommitted = false;
+	NumSamples = 0;
+	NextSample = 0;
+	StartLocation = Location;
+	DPIScale = GetDPIScale();
+	AddSample(Location);
+}
+
+void URunnerGestureComponent::TouchMove(ETouchIndex::Type FingerIndex, const FVector2D& Location)
+{
+	if (FingerIndex != ActiveFinger)
+	{
+		return;
+	}
+	AddSample(Location);
+	if (!bCommitted)
+	{
+		TryCommitSwipe(false);
+	}
+}
+
+void URunnerGestureComponent::TouchEnd(ETouchIndex::Type FingerIndex, const FVector2D& Location)
+{
+	if (FingerIndex != ActiveFinger)
+	{
+		return;
+	}
+	ActiveFinger = INDEX_NONE;
+	if (bCommitted)
+	{
+		return;
+	}
+	AddSample(Location);
+	if (FVector2D::Distance(Location, StartLocation) < TapDistance * DPIScale)
+	{
+		Commit(ERunnerCommand::Fire, Location);
+		return;
+	}
+	TryCommitSwipe(true);
+}
+
+void URunnerGestureComponent::AddSample(const FVector2D& Location)
+{
+	Samples[NextSample].Location = Location;
+	Samples[NextSample].Time = GetWorld()->GetRealTimeSeconds();
+	NextSample = (NextSample + 1) % MaxSamples;
+	NumSamples = FMath::Min(NumSamples + 1, MaxSamples);
+}
+
+void URunnerGestureComponent::TryCommitSwipe(bool bFingerLifted)
+{
+	const FRunnerTouchSample& Newest = Samples[(NextSample + MaxSamples - 1) % MaxSamples];
+	const FVector2D Delta = Newest.Location - StartLocation;
+	const float Distance = Delta.Size();
+	// A lifted finger past TapDistance is always a swipe, so no gesture falls between the thresholds
+	if (!bFingerLifted && Distance < MinSwipeDistance * DPIScale)
+	{
+		return;
+	}
+
+	// Speed over the most recent samples, so a slow start does not hide a flick
+	float Speed = 0.0f;
+	for (int32 Age = NumSamples - 1; Age > 0; Age--)
+	{
+		const FRunnerTouchSample& Oldest = Samples[(NextSample + MaxSamples - 1 - Age) % MaxSamples];
+		const double Elapsed = Newest.Time - Oldest.Time;
+		if (Elapsed > 0.0 && Elapsed <= SpeedWindow)
+		{
+			Speed = FVector2D::Distance(Newest.Location, Oldest.Location) / Elapsed;
+			break;
+		}
+	}
+
+	if (bFingerLifted || Distance >= SwipeDistance * DPIScale || Speed >= SwipeSpeed * DPIScale)
+	{
+		Commit(ClassifySwipe(Delta), Newest.Location);
+	}
+}
+
+void URunnerGestureComponent::Commit(ERunnerCommand Command, const FVector2D& Location)
+{
+	bCommitted = true;
+	UE_LOG(LogRunner, Verbose, TEXT("Gesture recognised as %s"), *UEnum::GetValueAsString(Command));
+	OnGesture.ExecuteIfBound(Command, Location);
+}
+
+ERunnerCommand URunnerGestureComponent::ClassifySwipe(const FVector2D& Delta)
+{
+	if (FMath::Abs(Delta.X) > FMath::Abs(Delta.Y))
+	{
+		return Delta.X > 0.0f ? ERunnerCommand::MoveRight : ERunnerCommand::MoveLeft;
+	}
+	return Delta.Y > 0.0f ? ERunnerCommand::Jump : ERunnerCommand::Slide;
+}
+
+float URunnerGestureComponent::GetDPIScale() const
+{
+	if (GEngine == nullptr || GEngine->GameViewport == nullptr)
+	{
+		return 1.0f;
+	}
+	FVector2D ViewportSize;
+	GEngine->GameViewport->GetViewportSize(ViewportSize);
+	return GetDefault<UUserInterfaceSettings>()->GetDPIScaleBasedOnSize(FIntPoint(ViewportSize.X, ViewportSize.Y));
+}
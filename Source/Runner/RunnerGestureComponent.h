@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "InputCoreTypes.h"
+#include "RunnerGestureComponent.generated.h"
+
+enum class ERunnerCommand : uint8;
+
+/** Command recognised from a gesture, with the screen location it ended at */
+DECLARE_DELEGATE_TwoParams(FRunnerGestureDelegate, ERunnerCommand, const FVector2D&);
+
+/** One touch sample in screen pixels */
+struct FRunnerTouchSample
+{
+	FVector2D Location;
+
+	double Time;
+};
+
+/**
+ * Turns touch events into runner commands. Swipes are committed while the finger is still moving,
+ * as soon as they cover enough distance or move fast enough, and every gesture yields at most one
+ * command. Thresholds are in density-independent pixels and scaled by the UI DPI curve.
+ */
+UCLASS(ClassGroup = (Runner), meta = (BlueprintSpawnableComponent))
+class RUNNER_API URunnerGestureComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	URunnerGestureComponent();
+
+	void TouchBegin(ETouchIndex::Type FingerIndex, const FVector2D& Location);
+
+	void TouchMove(ETouchIndex::Type FingerIndex, const FVector2D& Location);
+
+	void TouchEnd(ETouchIndex::Type FingerIndex, const FVector2D& Location);
+
+	/** Receives swipes as move/jump/slide commands and taps as Fire */
+	FRunnerGestureDelegate OnGesture;
+
+	/** Distance that commits a swipe straight away */
+	UPROPERTY(EditDefaultsOnly, Category = "Gesture")
+	float SwipeDistance = 60.0f;
+
+	/** Speed, per second, that commits a swipe once it has covered MinSwipeDistance */
+	UPROPERTY(EditDefaultsOnly, Category = "Gesture")
+	float SwipeSpeed = 800.0f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Gesture")
+	float MinSwipeDistance = 20.0f;
+
+	/** Gestures ending within this distance of where they began are taps, any further are swipes */
+	UPROPERTY(EditDefaultsOnly, Category = "Gesture")
+	float TapDistance = 12.0f;
+
+	/** Seconds of samples the swipe speed is measured over */
+	UPROPERTY(EditDefaultsOnly, Category = "Gesture")
+	float SpeedWindow = 0.08f;
+
+protected:
+	static const int32 MaxSamples = 8;
+
+	void AddSample(const FVector2D& Location);
+
+	/** Commits a swipe if the gesture has gone far or fast enough, or unconditionally once the finger lifts */
+	void TryCommitSwipe(bool bFingerLifted);
+
+	void Commit(ERunnerCommand Command, const FVector2D& Location);
+
+	static ERunnerCommand ClassifySwipe(const FVector2D& Delta);
+
+	float GetDPIScale() const;
+
+	FRunnerTouchSample Samples[MaxSamples];
+
+	int32 NumSamples;
+
+	int32 NextSample;
+
+	FVector2D StartLocation;
+
+	/** Finger being tracked, other fingers are ignored until it lifts */
+	int32 ActiveFinger;
+
+	bool bCommitted;
+
+	/** Pixels per density-independent pixel, sampled when the gesture starts */
+	float DPIScale;
+};
@@ -0,0 +1,331 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerGhost.h"
+#include "Runner.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace RunnerGhost
+{
+	static const uint32 Magic = 0x48474E52;
+
+	/** 2 added the track seed and map, older ghosts cannot be matched to a track and are not read */
+	static const uint8 Version = 2;
+
+	/** Centimetres per location unit */
+	static const float LocationUnit = 1.0f;
+
+	static const float YawUnit = 360.0f / 65536.0f;
+
+	enum EFieldMask : uint8
+	{
+		FieldX = 1 << 0,
+		FieldY = 1 << 1,
+		FieldZ = 1 << 2,
+		FieldYaw = 1 << 3,
+		FieldDesiredYaw = 1 << 4,
+		FieldLaneState = 1 << 5
+	};
+
+	static uint32 ZigZag(int32 Value)
+	{
+		return (uint32(Value) << 1) ^ uint32(Value >> 31);
+	}
+
+	static int32 UnZigZag(uint32 Value)
+	{
+		return int32(Value >> 1) ^ -int32(Value & 1);
+	}
+
+	static void WriteVarint(TArray<uint8>& Bytes, uint32 Value)
+	{
+		do
+		{
+			const uint8 Low = Value & 0x7f;
+			Value >>= 7;
+			Bytes.Add(Value != 0 ? (Low | 0x80) : Low);
+		}
+		while (Value != 0);
+	}
+
+	static bool ReadVarint(const TArray<uint8>& Bytes, int32& Cursor, uint32& OutValue)
+	{
+		OutValue = 0;
+		for (int32 Shift = 0; Shift < 35; Shift += 7)
+		{
+			if (!Bytes.IsValidIndex(Cursor))
+			{
+				return false;
+			}
+			const uint8 Byte = Bytes[Cursor++];
+			OutValue |= uint32(Byte & 0x7f) << Shift;
+			if ((Byte & 0x80) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static uint16 QuantizeYaw(float Yaw)
+	{
+		float Clamped = FMath::Fmod(Yaw, 360.0f);
+		if (Clamped < 0.0f)
+		{
+			Clamped += 360.0f;
+		}
+		return uint16(FMath::RoundToInt(Clamped / YawUnit));
+	}
+
+	/** Constant-velocity guess from the last two values */
+	static int32 Predict(int32 Previous, int32 BeforePrevious)
+	{
+		return Previous + (Previous - BeforePrevious);
+	}
+}
+
+void FRunnerGhostStream::Reset(float InSampleInterval, int32 InSeed, const FString& InMap)
+{
+	Bytes.Reset();
+	ChunkOffsets.Reset();
+	SampleInterval = InSampleInterval;
+	NumSamples = 0;
+	Seed = InSeed;
+	Map = InMap;
+	Previous = FQuantizedSample();
+	BeforePrevious = FQuantizedSample();
+}
+
+FRunnerGhostStream::FQuantizedSample FRunnerGhostStream::Quantize(const FRunnerGhostSample& Sample)
+{
+	FQuantizedSample Quantized;
+	Quantized.X = FMath::RoundToInt(Sample.Location.X / RunnerGhost::LocationUnit);
+	Quantized.Y = FMath::RoundToInt(Sample.Location.Y / RunnerGhost::LocationUnit);
+	Quantized.Z = FMath::RoundToInt(Sample.Location.Z / RunnerGhost::LocationUnit);
+	Quantized.Yaw = RunnerGhost::QuantizeYaw(Sample.Yaw);
+	Quantized.DesiredYaw = RunnerGhost::QuantizeYaw(Sample.DesiredYaw);
+	Quantized.Lane = uint8(FMath::Clamp(Sample.Lane, 0, 255));
+	Quantized.State = uint8(Sample.State);
+	return Quantized;
+}
+
+FRunnerGhostSample FRunnerGhostStream::Dequantize(const FQuantizedSample& Quantized)
+{
+	FRunnerGhostSample Sample;
+	Sample.Location = FVector(Quantized.X, Quantized.Y, Quantized.Z) * RunnerGhost::LocationUnit;
+	Sample.Yaw = FMath::UnwindDegrees(Quantized.Yaw * RunnerGhost::YawUnit);
+	Sample.DesiredYaw = FMath::UnwindDegrees(Quantized.DesiredYaw * RunnerGhost::YawUnit);
+	Sample.Lane = Quantized.Lane;
+	Sample.State = ERunnerMovementState(Quantized.State);
+	return Sample;
+}
+
+FRunnerGhostSample FRunnerGhostStream::RoundTrip(const FRunnerGhostSample& Sample)
+{
+	return Dequantize(Quantize(Sample));
+}
+
+void FRunnerGhostStream::Add(const FRunnerGhostSample& Sample)
+{
+	using namespace RunnerGhost;
+	const bool bChunkStart = NumSamples % ChunkSamples == 0;
+	if (bChunkStart)
+	{
+		// Predicting from zero makes the first residuals of a chunk its absolute values
+		ChunkOffsets.Add(Bytes.Num());
+		Previous = FQuantizedSample();
+		BeforePrevious = FQuantizedSample();
+	}
+	const FQuantizedSample Quantized = Quantize(Sample);
+	const uint32 X = ZigZag(Quantized.X - Predict(Previous.X, BeforePrevious.X));
+	const uint32 Y = ZigZag(Quantized.Y - Predict(Previous.Y, BeforePrevious.Y));
+	const uint32 Z = ZigZag(Quantized.Z - Predict(Previous.Z, BeforePrevious.Z));
+	const uint32 Yaw = ZigZag(int16(uint16(Quantized.Yaw - Previous.Yaw)));
+	const uint32 DesiredYaw = ZigZag(int16(uint16(Quantized.DesiredYaw - Previous.DesiredYaw)));
+	const bool bLaneState = bChunkStart || Quantized.Lane != Previous.Lane || Quantized.State != Previous.State;
+
+	const uint8 Mask = (X ? FieldX : 0) | (Y ? FieldY : 0) | (Z ? FieldZ : 0) | (Yaw ? FieldYaw : 0) | (DesiredYaw ? FieldDesiredYaw : 0) | (bLaneState ? FieldLaneState : 0);
+	Bytes.Add(Mask);
+	for (const uint32 Field : { X, Y, Z, Yaw, DesiredYaw })
+	{
+		if (Field != 0)
+		{
+			WriteVarint(Bytes, Field);
+		}
+	}
+	if (bLaneState)
+	{
+		Bytes.Add(Quantized.Lane);
+		Bytes.Add(Quantized.State);
+	}
+
+	// The first sample of a chunk has no velocity to carry into the prediction
+	BeforePrevious = bChunkStart ? Quantized : Previous;
+	Previous = Quantized;
+	NumSamples++;
+}
+
+bool FRunnerGhostStream::DecodeChunk(int32 ChunkIndex, TArray<FRunnerGhostSample>& OutSamples) const
+{
+	using namespace RunnerGhost;
+	OutSamples.Reset();
+	if (!ChunkOffsets.IsValidIndex(ChunkIndex))
+	{
+		return false;
+	}
+	const int32 NumInChunk = FMath::Min(ChunkSamples, NumSamples - ChunkIndex * ChunkSamples);
+	int32 Cursor = ChunkOffsets[ChunkIndex];
+	FQuantizedSample Last;
+	FQuantizedSample BeforeLast;
+	for (int32 Index = 0; Index < NumInChunk; Index++)
+	{
+		if (!Bytes.IsValidIndex(Cursor))
+		{
+			return false;
+		}
+		const uint8 Mask = Bytes[Cursor++];
+		uint32 Fields[5] = { 0, 0, 0, 0, 0 };
+		for (int32 Field = 0; Field < int32(UE_ARRAY_COUNT(Fields)); Field++)
+		{
+			if ((Mask & (1 << Field)) != 0 && !ReadVarint(Bytes, Cursor, Fields[Field]))
+			{
+				return false;
+			}
+		}
+
+		FQuantizedSample Quantized;
+		Quantized.X = Predict(Last.X, BeforeLast.X) + UnZigZag(Fields[0]);
+		Quantized.Y = Predict(Last.Y, BeforeLast.Y) + UnZigZag(Fields[1]);
+		Quantized.Z = Predict(Last.Z, BeforeLast.Z) + UnZigZag(Fields[2]);
+		Quantized.Yaw = uint16(Last.Yaw + UnZigZag(Fields[3]));
+		Quantized.DesiredYaw = uint16(Last.DesiredYaw + UnZigZag(Fields[4]));
+		Quantized.Lane = Last.Lane;
+		Quantized.State = Last.State;
+		if ((Mask & FieldLaneState) != 0)
+		{
+			if (!Bytes.IsValidIndex(Cursor + 1))
+			{
+				return false;
+			}
+			Quantized.Lane = Bytes[Cursor++];
+			Quantized.State = Bytes[Cursor++];
+		}
+
+		BeforeLast = Index == 0 ? Quantized : Last;
+		Last = Quantized;
+		OutSamples.Add(Dequantize(Quantized));
+	}
+	return true;
+}
+
+bool FRunnerGhostStream::Save(const FString& Path) const
+{
+	TArray<uint8> File;
+	FMemoryWriter Writer(File);
+	uint32 SavedMagic = RunnerGhost::Magic;
+	uint8 SavedVersion = RunnerGhost::Version;
+	int32 SavedSeed = Seed;
+	FString SavedMap = Map;
+	float SavedSampleInterval = SampleInterval;
+	int32 SavedNumSamples = NumSamples;
+	int32 NumChunks = ChunkOffsets.Num();
+	Writer << SavedMagic << SavedVersion << SavedSeed << SavedMap << SavedSampleInterval << SavedNumSamples << NumChunks;
+	for (int32 Offset : ChunkOffsets)
+	{
+		Writer << Offset;
+	}
+	int32 NumBytes = Bytes.Num();
+	Writer << NumBytes;
+	Writer.Serialize(const_cast<uint8*>(Bytes.GetData()), Bytes.Num());
+	return FFileHelper::SaveArrayToFile(File, *Path);
+}
+
+bool FRunnerGhostStream::Load(const FString& Path)
+{
+	TArray<uint8> File;
+	if (!FFileHelper::LoadFileToArray(File, *Path))
+	{
+		return false;
+	}
+	FMemoryReader Reader(File);
+	uint32 LoadedMagic = 0;
+	uint8 LoadedVersion = 0;
+	Reader << LoadedMagic << LoadedVersion;
+	if (LoadedMagic != RunnerGhost::Magic || LoadedVersion != RunnerGhost::Version)
+	{
+		UE_LOG(LogRunner, Warning, TEXT("%s is not a runner ghost of version %d"), *Path, RunnerGhost::Version);
+		return false;
+	}
+	Reset(0.0f);
+	int32 NumChunks = 0;
+	Reader << Seed << Map << SampleInterval << NumSamples << NumChunks;
+	if (Reader.IsError() || NumChunks != FMath::DivideAndRoundUp(NumSamples, ChunkSamples))
+	{
+		UE_LOG(LogRunner, Warning, TEXT("%s has a damaged header"), *Path);
+		Reset(0.0f);
+		return false;
+	}
+	ChunkOffsets.SetNumUninitialized(NumChunks);
+	for (int32& Offset : ChunkOffsets)
+	{
+		Reader << Offset;
+	}
+	int32 NumBytes = 0;
+	Reader << NumBytes;
+	if (Reader.IsError() || NumBytes != File.Num() - Reader.Tell())
+	{
+		UE_LOG(LogRunner, Warning, TEXT("%s is truncated"), *Path);
+		Reset(0.0f);
+		return false;
+	}
+	Bytes.Append(File.GetData() + Reader.Tell(), NumBytes);
+	return true;
+}
+
+void FRunnerGhostPlayback::Init(const FRunnerGhostStream* InStream)
+{
+	Stream = InStream;
+	ChunkIndices[0] = INDEX_NONE;
+	ChunkIndices[1] = INDEX_NONE;
+	NumDecodes = 0;
+}
+
+bool FRunnerGhostPlayback::Evaluate(float Time, FRunnerGhostSample& OutSample)
+{
+	if (Stream == nullptr || Stream->Num() == 0 || Time < 0.0f || Time > Stream->GetDuration())
+	{
+		return false;
+	}
+	const float Position = Stream->GetSampleInterval() > 0.0f ? Time / Stream->GetSampleInterval() : 0.0f;
+	const int32 Index = FMath::Min(FMath::FloorToInt(Position), Stream->Num() - 1);
+	const float Alpha = Position - Index;
+
+	// Neighbouring samples are in the same chunk or in chunks of opposite parity, so both stay decoded
+	const FRunnerGhostSample& From = GetSample(Index);
+	const FRunnerGhostSample& To = GetSample(FMath::Min(Index + 1, Stream->Num() - 1));
+	OutSample = From;
+	OutSample.Location = FMath::Lerp(From.Location, To.Location, Alpha);
+	OutSample.Yaw = FMath::UnwindDegrees(From.Yaw + FMath::UnwindDegrees(To.Yaw - From.Yaw) * Alpha);
+	return true;
+}
+
+const FRunnerGhostSample& FRunnerGhostPlayback::GetSample(int32 Index)
+{
+	const int32 ChunkIndex = Index / FRunnerGhostStream::ChunkSamples;
+	const int32 Slot = ChunkIndex & 1;
+	if (ChunkIndices[Slot] != ChunkIndex)
+	{
+		if (!Stream->DecodeChunk(ChunkIndex, Chunks[Slot]))
+		{
+			UE_LOG(LogRunner, Warning, TEXT("Ghost chunk %d could not be decoded"), ChunkIndex);
+		}
+		ChunkIndices[Slot] = ChunkIndex;
+		NumDecodes++;
+	}
+	const TArray<FRunnerGhostSample>& Chunk = Chunks[Slot];
+	const int32 InChunk = Index % FRunnerGhostStream::ChunkSamples;
+	static const FRunnerGhostSample Empty;
+	return Chunk.IsValidIndex(InChunk) ? Chunk[InChunk] : Empty;
+}
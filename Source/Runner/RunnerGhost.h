@@ -0,0 +1,135 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RunnerMovementState.h"
+
+/** What a ghost shows of the runner at one instant */
+struct FRunnerGhostSample
+{
+	/** Capsule centre */
+	FVector Location = FVector::ZeroVector;
+
+	float Yaw = 0.0f;
+
+	/** Heading the runner is turning towards, ARunnerCharacter::DesiredRotation */
+	float DesiredYaw = 0.0f;
+
+	int32 Lane = 0;
+
+	ERunnerMovementState State = ERunnerMovementState::Run;
+};
+
+/**
+ * A run sampled at a fixed rate, quantized and delta-encoded.
+ *
+ * Locations are stored in whole centimetres as the residual from a constant-velocity prediction,
+ * yaws as 16-bit angles relative to the previous sample, and lane and state only when they change.
+ * Each sample is a mask byte naming its non-zero fields followed by those fields as zigzag LEB128
+ * varints, so steady running costs one byte per sample. Every ChunkSamples samples the predictor
+ * restarts, which lets playback decode any chunk on its own.
+ *
+ * File layout: "RNGH" magic, version byte, track seed (int32), map package (FString), sample
+ * interval (float), sample count (int32), chunk count (int32), chunk byte offsets (int32 each),
+ * byte count (int32), then the encoded bytes.
+ */
+class RUNNER_API FRunnerGhostStream
+{
+public:
+	static constexpr int32 ChunkSamples = 64;
+
+	/** Starts an empty run on the track generated from InSeed on InMap */
+	void Reset(float InSampleInterval, int32 InSeed = 0, const FString& InMap = FString());
+
+	void Add(const FRunnerGhostSample& Sample);
+
+	/** Replaces OutSamples with the samples of one chunk, false if there is no such chunk */
+	bool DecodeChunk(int32 ChunkIndex, TArray<FRunnerGhostSample>& OutSamples) const;
+
+	bool Save(const FString& Path) const;
+
+	bool Load(const FString& Path);
+
+	int32 Num() const { return NumSamples; }
+
+	int32 GetNumChunks() const { return ChunkOffsets.Num(); }
+
+	float GetSampleInterval() const { return SampleInterval; }
+
+	/** Track seed of the run, a ghost only makes sense on the same track */
+	int32 GetSeed() const { return Seed; }
+
+	/** Map package the run was on */
+	const FString& GetMap() const { return Map; }
+
+	float GetDuration() const { return NumSamples > 1 ? (NumSamples - 1) * SampleInterval : 0.0f; }
+
+	/** Encoded size of the samples, without the header */
+	int32 GetNumBytes() const { return Bytes.Num(); }
+
+	/** The sample as it reads back after quantization */
+	static FRunnerGhostSample RoundTrip(const FRunnerGhostSample& Sample);
+
+private:
+	struct FQuantizedSample
+	{
+		int32 X = 0;
+		int32 Y = 0;
+		int32 Z = 0;
+		uint16 Yaw = 0;
+		uint16 DesiredYaw = 0;
+		uint8 Lane = 0;
+		uint8 State = 0;
+	};
+
+	static FQuantizedSample Quantize(const FRunnerGhostSample& Sample);
+
+	static FRunnerGhostSample Dequantize(const FQuantizedSample& Sample);
+
+	TArray<uint8> Bytes;
+
+	/** Where each chunk starts in Bytes */
+	TArray<int32> ChunkOffsets;
+
+	float SampleInterval = 0.0f;
+
+	int32 NumSamples = 0;
+
+	int32 Seed = 0;
+
+	FString Map;
+
+	/** Last two samples added to the current chunk, the encoder's prediction state */
+	FQuantizedSample Previous;
+
+	FQuantizedSample BeforePrevious;
+};
+
+/**
+ * Reads a ghost back at any time, decoding a chunk only when playback reaches it. The two most
+ * recent chunks stay decoded so interpolating across a chunk boundary never decodes twice.
+ */
+class RUNNER_API FRunnerGhostPlayback
+{
+public:
+	void Init(const FRunnerGhostStream* InStream);
+
+	/** Sample interpolated at Time seconds into the run, false once the run is over */
+	bool Evaluate(float Time, FRunnerGhostSample& OutSample);
+
+	/** Chunks decoded since Init */
+	int32 GetNumDecodes() const { return NumDecodes; }
+
+private:
+	const FRunnerGhostSample& GetSample(int32 Index);
+
+	const FRunnerGhostStream* Stream = nullptr;
+
+	/** Decoded chunks, even chunk indices in slot 0 and odd ones in slot 1 */
+	TArray<FRunnerGhostSample> Chunks[2];
+
+	int32 ChunkIndices[2] = { INDEX_NONE, INDEX_NONE };
+
+	int32 NumDecodes = 0;
+};
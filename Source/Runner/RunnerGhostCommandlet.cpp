@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerGhostCommandlet.h"
+#include "Runner.h"
+#include "RunnerGhost.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+URunnerGhostCommandlet::URunnerGhostCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 URunnerGhostCommandlet::Main(const FString& Params)
+{
+	FString InputPath;
+	if (!FParse::Value(*Params, TEXT("Input="), InputPath))
+	{
+		UE_LOG(LogRunner, Error, TEXT("Usage: -run=RunnerGhost -Input=<ghost file> [-Output=<csv file>]"));
+		return 1;
+	}
+	return Export(InputPath, Params);
+}
+
+int32 URunnerGhostCommandlet::Export(const FString& InputPath, const FString& Params)
+{
+	FString OutputPath = FPaths::ChangeExtension(InputPath, TEXT("csv"));
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	FRunnerGhostStream Stream;
+	if (!Stream.Load(InputPath))
+	{
+		UE_LOG(LogRunner, Error, TEXT("Could not read a ghost from %s"), *InputPath);
+		return 1;
+	}
+
+	const UEnum* States = StaticEnum<ERunnerMovementState>();
+	FString Csv = TEXT("Time,X,Y,Z,Yaw,DesiredYaw,Lane,State\n");
+	Csv.Reserve(Stream.Num() * 64);
+	TArray<FRunnerGhostSample> Decoded;
+	for (int32 Chunk = 0; Chunk < Stream.GetNumChunks(); Chunk++)
+	{
+		if (!Stream.DecodeChunk(Chunk, Decoded))
+		{
+			UE_LOG(LogRunner, Error, TEXT("%s is corrupt at chunk %d"), *InputPath, Chunk);
+			return 1;
+		}
+		for (int32 InChunk = 0; InChunk < Decoded.Num(); InChunk++)
+		{
+			const FRunnerGhostSample& Sample = Decoded[InChunk];
+			const float Time = (Chunk * FRunnerGhostStream::ChunkSamples + InChunk) * Stream.GetSampleInterval();
+			Csv += FString::Printf(TEXT("%.3f,%.0f,%.0f,%.0f,%.2f,%.2f,%d,%s\n"), Time, Sample.Location.X, Sample.Location.Y, Sample.Location.Z,
+				Sample.Yaw, Sample.DesiredYaw, Sample.Lane, *States->GetNameStringByValue(int64(Sample.State)));
+		}
+	}
+	if (!FFileHelper::SaveStringToFile(Csv, *OutputPath))
+	{
+		UE_LOG(LogRunner, Error, TEXT("Could not write %s"), *OutputPath);
+		return 1;
+	}
+	UE_LOG(LogRunner, Display, TEXT("Wrote %d ghost samples (%.1fs, %d bytes) to %s"), Stream.Num(), Stream.GetDuration(), Stream.GetNumBytes(), *OutputPath);
+	return 0;
+}
@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "RunnerGhostCommandlet.generated.h"
+
+/**
+ * Converts a ghost to CSV for inspection. The codec itself is covered by the Runner.Ghost
+ * automation tests.
+ *
+ * UnrealEditor-Cmd Runner.uproject -run=RunnerGhost -Input=Saved/Ghosts/BestRun.rngh
+ *     [-Output=Saved/Ghosts/BestRun.csv]
+ */
+UCLASS()
+class URunnerGhostCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	URunnerGhostCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	int32 Export(const FString& InputPath, const FString& Params);
+};
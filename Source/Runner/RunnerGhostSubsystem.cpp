@@ -0,0 +1,171 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerGhostSubsystem.h"
+#include "Runner.h"
+#include "RunnerCharacter.h"
+#include "RunnerGameMode.h"
+#include "RunnerPreloadSubsystem.h"
+#include "TrackGeneratorComponent.h"
+#include "Engine/World.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Paths.h"
+
+void URunnerGhostSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	if (!bEnableGhost || FParse::Param(FCommandLine::Get(), TEXT("NoGhost")))
+	{
+		bEnableGhost = false;
+		return;
+	}
+	const FString Path = GetGhostPath();
+	if (FPaths::FileExists(Path) && BestRun.Load(Path))
+	{
+		UE_LOG(LogRunner, Log, TEXT("Loaded a %.1fs ghost from %s (%d bytes)"), BestRun.GetDuration(), *Path, BestRun.GetNumBytes());
+	}
+}
+
+void URunnerGhostSubsystem::Deinitialize()
+{
+	FinishRun();
+	Super::Deinitialize();
+}
+
+FString URunnerGhostSubsystem::GetGhostPath() const
+{
+	return FPaths::IsRelative(GhostFile) ? FPaths::ProjectSavedDir() / GhostFile : GhostFile;
+}
+
+bool URunnerGhostSubsystem::GetGhostSample(FRunnerGhostSample& OutSample) const
+{
+	if (!bHasGhostSample)
+	{
+		return false;
+	}
+	OutSample = GhostSample;
+	return true;
+}
+
+FRunnerGhostSample URunnerGhostSubsystem::Capture(const ARunnerCharacter* Runner)
+{
+	FRunnerGhostSample Sample;
+	Sample.Location = Runner->GetActorLocation();
+	Sample.Yaw = Runner->GetActorRotation().Yaw;
+	Sample.DesiredYaw = Runner->DesiredRotation.Yaw;
+	Sample.Lane = Runner->CurrentLane;
+	Sample.State = Runner->GetMovementState();
+	return Sample;
+}
+
+void URunnerGhostSubsystem::StartRun(ARunnerCharacter* InRunner)
+{
+	const ARunnerGameMode* GameMode = GetWorld()->GetAuthGameMode<ARunnerGameMode>();
+	const int32 Seed = GameMode && GameMode->TrackGenerator ? GameMode->TrackGenerator->Seed : 0;
+	const FString Map = UWorld::RemovePIEPrefix(GetWorld()->GetOutermost()->GetName());
+	if (BestRun.Num() > 0 && (BestRun.GetSeed() != Seed || BestRun.GetMap() != Map))
+	{
+		// Raced on another track the ghost would run through walls, and any run here beats it
+		UE_LOG(LogRunner, Log, TEXT("Ignoring the ghost from %s with seed %d, this run is on %s with seed %d"), *BestRun.GetMap(), BestRun.GetSeed(), *Map, Seed);
+		BestRun.Reset(0.0f);
+	}
+
+	Runner = InRunner;
+	bRunStarted = true;
+	bRecording = true;
+	RunTime = 0.0f;
+	NextSampleTime = 0.0f;
+	Recording.Reset(1.0f / FMath::Max(SampleRate, 1.0f), Seed, Map);
+	Playback.Init(&BestRun);
+
+	UClass* Class = BestRun.Num() > 0 && GhostClass.IsValid() ? Cast<UClass>(URunnerPreloadSubsystem::Resolve(GhostClass)) : nullptr;
+	if (Class != nullptr)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		GhostActor = GetWorld()->SpawnActor<AActor>(Class, InRunner->GetActorTransform(), SpawnParams);
+		if (GhostActor != nullptr)
+		{
+			GhostActor->SetActorEnableCollision(false);
+		}
+	}
+}
+
+void URunnerGhostSubsystem::FinishRun()
+{
+	if (!bRecording)
+	{
+		return;
+	}
+	bRecording = false;
+	if (Recording.GetDuration() <= BestRun.GetDuration())
+	{
+		return;
+	}
+	const FString Path = GetGhostPath();
+	if (!Recording.Save(Path))
+	{
+		UE_LOG(LogRunner, Warning, TEXT("Could not save ghost to %s"), *Path);
+		return;
+	}
+	UE_LOG(LogRunner, Log, TEXT("New best run of %.1fs saved to %s (%d samples, %d bytes)"), Recording.GetDuration(), *Path, Recording.Num(), Recording.GetNumBytes());
+}
+
+void URunnerGhostSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	if (!bEnableGhost)
+	{
+		return;
+	}
+	if (!bRunStarted)
+	{
+		if (ARunnerCharacter* PlayerRunner = Cast<ARunnerCharacter>(UGameplayStatics::GetPlayerCharacter(this, 0)))
+		{
+			StartRun(PlayerRunner);
+		}
+		return;
+	}
+	RunTime += DeltaTime;
+
+	const ARunnerCharacter* RecordedRunner = Runner.Get();
+	if (bRecording && RecordedRunner != nullptr)
+	{
+		// Samples land on the fixed grid the stream assumes, whatever the frame rate
+		while (NextSampleTime <= RunTime)
+		{
+			Recording.Add(Capture(RecordedRunner));
+			NextSampleTime += Recording.GetSampleInterval();
+		}
+		if (RecordedRunner->GetMovementState() == ERunnerMovementState::Dead)
+		{
+			FinishRun();
+		}
+	}
+	else if (bRecording)
+	{
+		FinishRun();
+	}
+
+	bHasGhostSample = Playback.Evaluate(RunTime, GhostSample);
+	if (GhostActor != nullptr)
+	{
+		GhostActor->SetActorHiddenInGame(!bHasGhostSample);
+		if (bHasGhostSample)
+		{
+			GhostActor->SetActorLocationAndRotation(GhostSample.Location, FRotator(0.0f, GhostSample.Yaw, 0.0f));
+		}
+	}
+}
+
+TStatId URunnerGhostSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URunnerGhostSubsystem, STATGROUP_Tickables);
+}
+
+bool URunnerGhostSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
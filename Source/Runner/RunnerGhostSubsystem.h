@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RunnerGhost.h"
+#include "RunnerGhostSubsystem.generated.h"
+
+class ARunnerCharacter;
+
+/**
+ * Records the player's run as a ghost stream and plays back the best run so far alongside it.
+ * A run ends when the runner dies or the world goes away; it replaces the saved ghost if it lasted
+ * longer. Pass -NoGhost to neither record nor show one.
+ */
+UCLASS(config=Game)
+class RUNNER_API URunnerGhostSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	/** Where the best run ghost is at the current point of the run, false when there is none */
+	bool GetGhostSample(FRunnerGhostSample& OutSample) const;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void StartRun(ARunnerCharacter* Runner);
+
+	static FRunnerGhostSample Capture(const ARunnerCharacter* Runner);
+
+	/** Stops recording and saves the run if it beat the best one */
+	void FinishRun();
+
+	FString GetGhostPath() const;
+
+	UPROPERTY(Config)
+	bool bEnableGhost = true;
+
+	/** Samples recorded per second */
+	UPROPERTY(Config)
+	float SampleRate = 10.0f;
+
+	/** Best run file, relative to the project's Saved directory */
+	UPROPERTY(Config)
+	FString GhostFile = TEXT("Ghosts/BestRun.rngh");
+
+	/** Actor placed where the ghost runner's capsule is; no ghost is shown without one */
+	UPROPERTY(Config)
+	FSoftObjectPath GhostClass;
+
+	FRunnerGhostStream BestRun;
+
+	FRunnerGhostPlayback Playback;
+
+	FRunnerGhostStream Recording;
+
+	bool bRecording = false;
+
+	bool bRunStarted = false;
+
+	bool bHasGhostSample = false;
+
+	FRunnerGhostSample GhostSample;
+
+	float RunTime = 0.0f;
+
+	float NextSampleTime = 0.0f;
+
+	TWeakObjectPtr<ARunnerCharacter> Runner;
+
+	UPROPERTY()
+	AActor* GhostActor;
+};
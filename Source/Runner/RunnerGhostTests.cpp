@@ -0,0 +1,232 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerGhost.h"
+#include "Runner.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace RunnerGhostTests
+{
+	/** A run that changes lane, jumps, slides and turns about as often as a player does */
+	void SynthesizeRun(int32 NumSamples, float SampleInterval, int32 Seed, TArray<FRunnerGhostSample>& OutSamples)
+	{
+		FRandomStream Random(Seed);
+		const float LaneWidth = 200.0f;
+		const float RunSpeed = 1200.0f;
+		FVector Location(0.0f, 0.0f, 90.0f);
+		float Yaw = 0.0f;
+		float DesiredYaw = 0.0f;
+		int32 Lane = 1;
+		float Lateral = 0.0f;
+		float JumpTime = -1.0f;
+		float SlideTime = -1.0f;
+
+		OutSamples.Reset(NumSamples);
+		for (int32 Index = 0; Index < NumSamples; Index++)
+		{
+			const float Time = Index * SampleInterval;
+			if (Random.FRand() < 0.05f)
+			{
+				Lane = FMath::Clamp(Lane + (Random.RandBool() ? 1 : -1), 0, 2);
+			}
+			if (JumpTime < 0.0f && SlideTime < 0.0f)
+			{
+				const float Roll = Random.FRand();
+				if (Roll < 0.03f)
+				{
+					JumpTime = Time;
+				}
+				else if (Roll < 0.05f)
+				{
+					SlideTime = Time;
+				}
+				else if (Roll < 0.06f && FMath::IsNearlyEqual(Yaw, DesiredYaw, 1.0f))
+				{
+					DesiredYaw = FMath::UnwindDegrees(DesiredYaw + (Random.RandBool() ? 90.0f : -90.0f));
+				}
+			}
+
+			ERunnerMovementState State = ERunnerMovementState::Run;
+			float Height = 0.0f;
+			if (JumpTime >= 0.0f)
+			{
+				const float Airborne = Time - JumpTime;
+				Height = 700.0f * Airborne - 0.5f * 1960.0f * Airborne * Airborne;
+				State = ERunnerMovementState::Jump;
+				if (Height <= 0.0f && Airborne > 0.0f)
+				{
+					Height = 0.0f;
+					JumpTime = -1.0f;
+					State = ERunnerMovementState::Run;
+				}
+			}
+			else if (SlideTime >= 0.0f)
+			{
+				State = ERunnerMovementState::Slide;
+				if (Time - SlideTime > 0.8f)
+				{
+					SlideTime = -1.0f;
+					State = ERunnerMovementState::Run;
+				}
+			}
+			const float YawError = FMath::FindDeltaAngleDegrees(Yaw, DesiredYaw);
+			if (!FMath::IsNearlyZero(YawError, 0.01f))
+			{
+				Yaw = FMath::UnwindDegrees(Yaw + FMath::Clamp(YawError, -720.0f * SampleInterval, 720.0f * SampleInterval));
+				State = State == ERunnerMovementState::Run ? ERunnerMovementState::Turn : State;
+			}
+
+			const float TargetLateral = (Lane - 1) * LaneWidth;
+			Lateral += FMath::Clamp(TargetLateral - Lateral, -1000.0f * SampleInterval, 1000.0f * SampleInterval);
+			const FRotator Heading(0.0f, Yaw, 0.0f);
+			Location += Heading.Vector() * RunSpeed * SampleInterval;
+
+			FRunnerGhostSample& Sample = OutSamples.AddDefaulted_GetRef();
+			Sample.Location = Location + Heading.RotateVector(FVector(0.0f, Lateral, Height));
+			Sample.Yaw = Yaw;
+			Sample.DesiredYaw = DesiredYaw;
+			Sample.Lane = Lane;
+			Sample.State = State;
+		}
+	}
+
+	bool SamplesMatch(const FRunnerGhostSample& A, const FRunnerGhostSample& B)
+	{
+		return A.Location.Equals(B.Location, 0.01f) && FMath::IsNearlyEqual(A.Yaw, B.Yaw, 0.01f) && FMath::IsNearlyEqual(A.DesiredYaw, B.DesiredYaw, 0.01f)
+			&& A.Lane == B.Lane && A.State == B.State;
+	}
+
+	/** Ten minutes at the ghost subsystem's default rate */
+	const int32 RunSamples = 6000;
+
+	const float RunSampleInterval = 0.1f;
+
+	/** Steady running costs one byte per sample; turns, jumps and lane changes must not double that */
+	const float MaxBytesPerSample = 2.0f;
+
+	/** Target cost of decoding the whole run chunk by chunk; timings are reported, not enforced */
+	const double MaxDecodeNanosecondsPerSample = 500.0;
+
+	/** Target cost of one 60 Hz playback frame, decodes included */
+	const double MaxPlaybackMicrosecondsPerFrame = 2.0;
+
+	const int32 RunSeed = 1234;
+
+	const TCHAR* RunMap = TEXT("/Game/ThirdPersonCPP/Maps/ThirdPersonExampleMap");
+
+	void Encode(const TArray<FRunnerGhostSample>& Samples, FRunnerGhostStream& OutStream)
+	{
+		OutStream.Reset(RunSampleInterval, RunSeed, RunMap);
+		for (const FRunnerGhostSample& Sample : Samples)
+		{
+			OutStream.Add(Sample);
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRunnerGhostRoundTripTest, "Runner.Ghost.RoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FRunnerGhostRoundTripTest::RunTest(const FString& Parameters)
+{
+	using namespace RunnerGhostTests;
+	TArray<FRunnerGhostSample> Samples;
+	SynthesizeRun(RunSamples, RunSampleInterval, 0, Samples);
+	FRunnerGhostStream Stream;
+	Encode(Samples, Stream);
+
+	const FString Path = FPaths::CreateTempFilename(*FPaths::ProjectIntermediateDir(), TEXT("Ghost"), TEXT(".rngh"));
+	FRunnerGhostStream Loaded;
+	const bool bSaved = Stream.Save(Path);
+	const bool bLoaded = bSaved && Loaded.Load(Path);
+	IFileManager::Get().Delete(*Path);
+	if (!TestTrue(TEXT("Ghost saves and loads"), bLoaded))
+	{
+		return false;
+	}
+	TestEqual(TEXT("Sample count after reload"), Loaded.Num(), RunSamples);
+	TestEqual(TEXT("Seed after reload"), Loaded.GetSeed(), RunSeed);
+	TestEqual(TEXT("Map after reload"), Loaded.GetMap(), FString(RunMap));
+	TestEqual(TEXT("Byte count after reload"), Loaded.GetNumBytes(), Stream.GetNumBytes());
+	TestEqual(TEXT("Chunk count"), Loaded.GetNumChunks(), FMath::DivideAndRoundUp(RunSamples, FRunnerGhostStream::ChunkSamples));
+
+	// Every sample must decode to exactly what quantization alone would give
+	int32 NumMismatches = 0;
+	int32 NumDecoded = 0;
+	TArray<FRunnerGhostSample> Decoded;
+	for (int32 Chunk = 0; Chunk < Loaded.GetNumChunks(); Chunk++)
+	{
+		if (!TestTrue(FString::Printf(TEXT("Chunk %d decodes"), Chunk), Loaded.DecodeChunk(Chunk, Decoded)))
+		{
+			return false;
+		}
+		for (int32 InChunk = 0; InChunk < Decoded.Num(); InChunk++)
+		{
+			const int32 Index = Chunk * FRunnerGhostStream::ChunkSamples + InChunk;
+			if (!SamplesMatch(Decoded[InChunk], FRunnerGhostStream::RoundTrip(Samples[Index])) && NumMismatches++ == 0)
+			{
+				AddError(FString::Printf(TEXT("Sample %d decoded as %s instead of %s"), Index, *Decoded[InChunk].Location.ToString(), *Samples[Index].Location.ToString()));
+			}
+		}
+		NumDecoded += Decoded.Num();
+	}
+	TestEqual(TEXT("Samples that did not round-trip"), NumMismatches, 0);
+	TestEqual(TEXT("Samples decoded"), NumDecoded, RunSamples);
+	TestFalse(TEXT("Chunk past the end decodes"), Loaded.DecodeChunk(Loaded.GetNumChunks(), Decoded));
+
+	// Played back at display rate, each chunk is decoded exactly once
+	FRunnerGhostPlayback Playback;
+	Playback.Init(&Loaded);
+	int32 NumFrames = 0;
+	FRunnerGhostSample Sample;
+	while (Playback.Evaluate(NumFrames / 60.0f, Sample))
+	{
+		NumFrames++;
+	}
+	TestEqual(TEXT("Chunks decoded by playback"), Playback.GetNumDecodes(), Loaded.GetNumChunks());
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRunnerGhostBudgetTest, "Runner.Ghost.Budget", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FRunnerGhostBudgetTest::RunTest(const FString& Parameters)
+{
+	using namespace RunnerGhostTests;
+	TArray<FRunnerGhostSample> Samples;
+	SynthesizeRun(RunSamples, RunSampleInterval, 0, Samples);
+	FRunnerGhostStream Stream;
+	Encode(Samples, Stream);
+
+	const float BytesPerSample = float(Stream.GetNumBytes()) / RunSamples;
+	AddInfo(FString::Printf(TEXT("%d samples in %d bytes, %.2f bytes/sample"), RunSamples, Stream.GetNumBytes(), BytesPerSample));
+	TestTrue(FString::Printf(TEXT("%.2f bytes/sample is within the budget of %.2f"), BytesPerSample, MaxBytesPerSample), BytesPerSample <= MaxBytesPerSample);
+
+	TArray<FRunnerGhostSample> Decoded;
+	const double DecodeStart = FPlatformTime::Seconds();
+	for (int32 Chunk = 0; Chunk < Stream.GetNumChunks(); Chunk++)
+	{
+		Stream.DecodeChunk(Chunk, Decoded);
+	}
+	const double DecodeNanoseconds = (FPlatformTime::Seconds() - DecodeStart) * 1e9 / RunSamples;
+	// Wall-clock timings swing with the machine and build, so they are reported rather than asserted
+	AddInfo(FString::Printf(TEXT("Decode %.1f ns/sample, target %.1f"), DecodeNanoseconds, MaxDecodeNanosecondsPerSample));
+
+	FRunnerGhostPlayback Playback;
+	Playback.Init(&Stream);
+	int32 NumFrames = 0;
+	FRunnerGhostSample Sample;
+	const double PlaybackStart = FPlatformTime::Seconds();
+	while (Playback.Evaluate(NumFrames / 60.0f, Sample))
+	{
+		NumFrames++;
+	}
+	const double PlaybackMicroseconds = NumFrames > 0 ? (FPlatformTime::Seconds() - PlaybackStart) * 1e6 / NumFrames : 0.0;
+	AddInfo(FString::Printf(TEXT("Playback %.3f us/frame over %d frames, target %.3f"), PlaybackMicroseconds, NumFrames, MaxPlaybackMicrosecondsPerFrame));
+	return true;
+}
+
+#endif
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerInputRecording.h"
+#include "Runner.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace RunnerInputRecording
+{
+	static const uint32 Magic = 0x49524E52;
+
+	static const uint8 Version = 2;
+
+	/** Oldest version Load still reads, from before the map was stored */
+	static const uint8 MinVersion = 1;
+}
+
+void FRunnerInputRecording::Reset(float InStepSeconds, int32 InSeed, const FString& InMap)
+{
+	Events.Reset();
+	StepSeconds = InStepSeconds;
+	Seed = InSeed;
+	Map = InMap;
+	NumEvents = 0;
+	LastStep = 0;
+}
+
+void FRunnerInputRecording::Add(uint32 Step, uint8 Command)
+{
+	uint32 Delta = Step >= LastStep ? Step - LastStep : 0;
+	do
+	{
+		const uint8 Low = Delta & 0x7f;
+		Delta >>= 7;
+		Events.Add(Delta != 0 ? (Low | 0x80) : Low);
+	}
+	while (Delta != 0);
+	Events.Add(Command);
+	LastStep = FMath::Max(LastStep, Step);
+	NumEvents++;
+}
+
+bool FRunnerInputRecording::Read(int32& Cursor, uint32& InOutStep, uint8& OutCommand) const
+{
+	uint32 Delta = 0;
+	for (int32 Shift = 0; Shift < 32; Shift += 7)
+	{
+		if (!Events.IsValidIndex(Cursor))
+		{
+			return false;
+		}
+		const uint8 Byte = Events[Cursor++];
+		Delta |= uint32(Byte & 0x7f) << Shift;
+		if ((Byte & 0x80) == 0)
+		{
+			if (!Events.IsValidIndex(Cursor))
+			{
+				return false;
+			}
+			OutCommand = Events[Cursor++];
+			InOutStep += Delta;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FRunnerInputRecording::Save(const FString& Path) const
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	uint32 Magic = RunnerInputRecording::Magic;
+	uint8 Version = RunnerInputRecording::Version;
+	float SavedStepSeconds = StepSeconds;
+	int32 SavedSeed = Seed;
+	FString SavedMap = Map;
+	int32 SavedNumEvents = NumEvents;
+	Writer << Magic << Version << SavedStepSeconds << SavedSeed << SavedMap << SavedNumEvents;
+	Writer.Serialize(const_cast<uint8*>(Events.GetData()), Events.Num());
+	return FFileHelper::SaveArrayToFile(Bytes, *Path);
+}
+
+bool FRunnerInputRecording::Load(const FString& Path)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Path))
+	{
+		return false;
+	}
+	FMemoryReader Reader(Bytes);
+	uint32 Magic = 0;
+	uint8 Version = 0;
+	Reader << Magic << Version;
+	if (Magic != RunnerInputRecording::Magic || Version < RunnerInputRecording::MinVersion || Version > RunnerInputRecording::Version)
+	{
+		UE_LOG(LogRunner, Warning, TEXT("%s is not a runner input recording"), *Path);
+		return false;
+	}
+	Reset(0.0f, 0);
+	Reader << StepSeconds << Seed;
+	if (Version >= 2)
+	{
+		Reader << Map;
+	}
+	Reader << NumEvents;
+	if (Reader.IsError())
+	{
+		UE_LOG(LogRunner, Warning, TEXT("%s is truncated"), *Path);
+		Reset(0.0f, 0);
+		return false;
+	}
+	Events.Append(Bytes.GetData() + Reader.Tell(), Bytes.Num() - Reader.Tell());
+
+	// Walk the events once so LastStep is known before playback
+	int32 Cursor = 0;
+	uint8 Command = 0;
+	while (Read(Cursor, LastStep, Command))
+	{
+	}
+	return true;
+}
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Compact log of gameplay commands keyed by simulation step.
+ *
+ * File layout: "RNRI" magic, version byte, step seconds (float), track seed (int32), map package
+ * (FString, version 2 on), event count (int32), then one event per command: the step delta from
+ * the previous event as a LEB128 varint followed by the command byte. A typical event takes two bytes.
+ */
+class RUNNER_API FRunnerInputRecording
+{
+public:
+	void Reset(float InStepSeconds, int32 InSeed, const FString& InMap = FString());
+
+	/** Appends a command; steps must not go backwards */
+	void Add(uint32 Step, uint8 Command);
+
+	/**
+	 * Decodes the event at Cursor and moves Cursor past it. InOutStep carries the step of the
+	 * previous event and receives the step of this one. Returns false at the end of the recording.
+	 */
+	bool Read(int32& Cursor, uint32& InOutStep, uint8& OutCommand) const;
+
+	bool Save(const FString& Path) const;
+
+	bool Load(const FString& Path);
+
+	float GetStepSeconds() const { return StepSeconds; }
+
+	int32 GetSeed() const { return Seed; }
+
+	/** Package of the map the run was recorded in, empty for recordings made before it was stored */
+	const FString& GetMap() const { return Map; }
+
+	int32 Num() const { return NumEvents; }
+
+	uint32 GetLastStep() const { return LastStep; }
+
+	/** Encoded size of the events, without the header */
+	int32 GetNumBytes() const { return Events.Num(); }
+
+private:
+	TArray<uint8> Events;
+
+	float StepSeconds = 0.0f;
+
+	int32 Seed = 0;
+
+	FString Map;
+
+	int32 NumEvents = 0;
+
+	uint32 LastStep = 0;
+};
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerLaneSystem.h"
+
+void FRunnerLaneSystem::Init(const TArray<FVector>& LanesPositions, float Yaw)
+{
+	LaneOffsets.Reset();
+	float Centre = 0.0f;
+	for (const FVector& Lane : LanesPositions)
+	{
+		Centre += Lane.Y;
+	}
+	Centre = LanesPositions.Num() > 0 ? Centre / LanesPositions.Num() : 0.0f;
+	for (const FVector& Lane : LanesPositions)
+	{
+		LaneOffsets.Add(Lane.Y - Centre);
+	}
+
+	// LanesPositions are authored in world space for the first straight
+	const FVector Origin = LanesPositions.Num() > 0 ? FVector(LanesPositions[0].X, Centre, LanesPositions[0].Z) : FVector::ZeroVector;
+	ActiveFrame = 0;
+	NumQueued = 0;
+	Frames[ActiveFrame] = MakeFrame(Yaw, Origin);
+}
+
+void FRunnerLaneSystem::QueueSegmentFrame(float Yaw, const FVector& Origin)
+{
+	if (NumQueued == MaxFrames - 1)
+	{
+		return;
+	}
+	NumQueued++;
+	Frames[(ActiveFrame + NumQueued) % MaxFrames] = MakeFrame(Yaw, Origin);
+}
+
+void FRunnerLaneSystem::OnCornerTurned(float Yaw, const FVector& RunnerLocation, int32 Lane)
+{
+	// Prefer the frame the track generator recorded for this heading, dropping any the runner skipped
+	while (NumQueued > 0)
+	{
+		ActiveFrame = (ActiveFrame + 1) % MaxFrames;
+		NumQueued--;
+		if (FMath::IsNearlyZero(FRotator::NormalizeAxis(Frames[ActiveFrame].Yaw - Yaw), 1.0f))
+		{
+			return;
+		}
+	}
+
+	// Hand-made course, so assume the runner is still in its lane
+	FLaneFrame& Frame = Frames[ActiveFrame];
+	Frame = MakeFrame(Yaw, RunnerLocation);
+	Frame.Origin -= Frame.Right * (LaneOffsets.IsValidIndex(Lane) ? LaneOffsets[Lane] : 0.0f);
+}
+
+float FRunnerLaneSystem::GetLateralOffset(const FVector& Location) const
+{
+	const FLaneFrame& Frame = Frames[ActiveFrame];
+	return FVector::DotProduct(Location - Frame.Origin, Frame.Right);
+}
+
+FLaneFrame FRunnerLaneSystem::MakeFrame(float Yaw, const FVector& Origin)
+{
+	float Sin = 0.0f;
+	float Cos = 0.0f;
+	FMath::SinCos(&Sin, &Cos, FMath::DegreesToRadians(Yaw));
+
+	FLaneFrame Frame;
+	Frame.Origin = Origin;
+	Frame.Right = FVector(-Sin, Cos, 0.0f);
+	Frame.Yaw = Yaw;
+	return Frame;
+}
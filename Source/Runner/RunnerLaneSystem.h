@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Lateral reference for one straight stretch of track */
+struct FLaneFrame
+{
+	/** A point on the track centre line */
+	FVector Origin = FVector::ZeroVector;
+
+	/** Unit vector pointing to the runner's right along this stretch */
+	FVector Right = FVector::RightVector;
+
+	float Yaw = 0.0f;
+};
+
+/**
+ * Lane offsets plus a small ring of precomputed lane frames, one per straight stretch of track.
+ * Frames are queued when the track generator places a tile that starts a new heading, or built
+ * from the runner's position when a corner is finished on a hand-made course.
+ */
+class RUNNER_API FRunnerLaneSystem
+{
+public:
+	static constexpr int32 MaxFrames = 16;
+
+	/** Builds the lane offsets around the middle of LanesPositions and the starting frame */
+	void Init(const TArray<FVector>& LanesPositions, float Yaw);
+
+	/** Records the frame of a stretch of track that the runner will reach after a corner */
+	void QueueSegmentFrame(float Yaw, const FVector& Origin);
+
+	/** Switches to the frame for the new heading once the runner has finished turning */
+	void OnCornerTurned(float Yaw, const FVector& RunnerLocation, int32 Lane);
+
+	int32 GetNumLanes() const { return LaneOffsets.Num(); }
+
+	const FLaneFrame& GetActiveFrame() const { return Frames[ActiveFrame]; }
+
+	/** Signed distance of a lane from the centre line, lanes out of range are clamped to the outermost */
+	float GetLaneOffset(int32 Lane) const { return LaneOffsets.Num() > 0 ? LaneOffsets[FMath::Clamp(Lane, 0, LaneOffsets.Num() - 1)] : 0.0f; }
+
+	/** Signed distance of a world location from the centre line of the active frame */
+	float GetLateralOffset(const FVector& Location) const;
+
+	static FLaneFrame MakeFrame(float Yaw, const FVector& Origin);
+
+private:
+	TArray<float, TInlineAllocator<8>> LaneOffsets;
+
+	FLaneFrame Frames[MaxFrames];
+
+	int32 ActiveFrame = 0;
+
+	int32 NumQueued = 0;
+};
@@ -0,0 +1,207 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerMovementComponent.h"
+#include "Runner.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/Controller.h"
+
+bool URunnerMovementComponent::IsOnTrack() const
+{
+	return MovementMode == MOVE_Custom && CustomMovementMode == uint8(ERunnerCustomMovementMode::Track);
+}
+
+void URunnerMovementComponent::SetLaneTarget(const FLaneFrame& Frame, float LateralOffset, float LateralSpeed)
+{
+	LaneFrame = Frame;
+	TargetLateralOffset = LateralOffset;
+	LaneSpeed = LateralSpeed;
+	bHasLaneTarget = true;
+}
+
+void URunnerMovementComponent::ClearLaneTarget()
+{
+	bHasLaneTarget = false;
+}
+
+bool URunnerMovementComponent::IsFalling() const
+{
+	return Super::IsFalling() || (IsOnTrack() && bTrackAirborne);
+}
+
+bool URunnerMovementComponent::IsMovingOnGround() const
+{
+	return Super::IsMovingOnGround() || (IsOnTrack() && !bTrackAirborne);
+}
+
+float URunnerMovementComponent::GetMaxSpeed() const
+{
+	if (IsOnTrack())
+	{
+		return IsCrouching() ? MaxWalkSpeedCrouched : MaxWalkSpeed;
+	}
+	return Super::GetMaxSpeed();
+}
+
+bool URunnerMovementComponent::DoJump(bool bReplayingMoves)
+{
+	if (!IsOnTrack())
+	{
+		return Super::DoJump(bReplayingMoves);
+	}
+	if (bTrackAirborne || CharacterOwner == nullptr || !CharacterOwner->CanJump())
+	{
+		return false;
+	}
+	// Stays in the track mode, PhysTrack flies the arc
+	TrackVerticalSpeed = JumpZVelocity;
+	bTrackAirborne = true;
+	return true;
+}
+
+void URunnerMovementComponent::OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode)
+{
+	Super::OnMovementModeChanged(PreviousMovementMode, PreviousCustomMode);
+	if (!IsOnTrack())
+	{
+		return;
+	}
+	TrackSpeed = Velocity.Size2D();
+	TrackVerticalSpeed = 0.0f;
+	bTrackAirborne = false;
+	// Crouching keeps the feet on the track, otherwise the standing capsule would not fit back
+	bCrouchMaintainsBaseLocation = true;
+}
+
+void URunnerMovementComponent::PhysWalking(float DeltaTime, int32 Iterations)
+{
+	Super::PhysWalking(DeltaTime, Iterations);
+	if (bUseTrackMovement && MovementMode == MOVE_Walking && CurrentFloor.IsWalkableFloor())
+	{
+		SetMovementMode(MOVE_Custom, uint8(ERunnerCustomMovementMode::Track));
+	}
+}
+
+void URunnerMovementComponent::PhysCustom(float DeltaTime, int32 Iterations)
+{
+	if (CustomMovementMode == uint8(ERunnerCustomMovementMode::Track))
+	{
+		PhysTrack(DeltaTime, Iterations);
+		return;
+	}
+	Super::PhysCustom(DeltaTime, Iterations);
+}
+
+void URunnerMovementComponent::PhysicsRotation(float DeltaTime)
+{
+	// PhysTrack already faces the character down the track
+	if (IsOnTrack())
+	{
+		return;
+	}
+	Super::PhysicsRotation(DeltaTime);
+}
+
+void URunnerMovementComponent::PhysTrack(float DeltaTime, int32 Iterations)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RunnerTrackMovement);
+	if (DeltaTime < MIN_TICK_TIME || CharacterOwner == nullptr)
+	{
+		return;
+	}
+	const FVector Location = UpdatedComponent->GetComponentLocation();
+	const float HalfHeight = CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	const float BaseZ = Location.Z - HalfHeight;
+
+	// Same heading and input rule as walking with AddMovementInput along the control yaw
+	AController* Controller = CharacterOwner->Controller;
+	const float TrackYaw = Controller != nullptr ? Controller->GetControlRotation().Yaw : UpdatedComponent->GetComponentRotation().Yaw;
+	const FQuat Rotation = FRotator(0.0f, TrackYaw, 0.0f).Quaternion();
+	TrackSpeed = FMath::FInterpConstantTo(TrackSpeed, Controller != nullptr ? GetMaxSpeed() : 0.0f, DeltaTime, GetMaxAcceleration());
+	FVector Delta = Rotation.GetForwardVector() * (TrackSpeed * DeltaTime);
+
+	if (bHasLaneTarget)
+	{
+		const float Remaining = TargetLateralOffset - FVector::DotProduct(Location - LaneFrame.Origin, LaneFrame.Right);
+		if (!FMath::IsNearlyZero(Remaining, 1.0f))
+		{
+			const float MaxStep = LaneSpeed * DeltaTime;
+			Delta += LaneFrame.Right * FMath::Clamp(Remaining, -MaxStep, MaxStep);
+		}
+	}
+
+	// Constant gravity, so the arc is integrated exactly whatever the step length
+	const float GravityZ = GetGravityZ();
+	if (bTrackAirborne)
+	{
+		Delta.Z = TrackVerticalSpeed * DeltaTime + 0.5f * GravityZ * DeltaTime * DeltaTime;
+		TrackVerticalSpeed += GravityZ * DeltaTime;
+	}
+
+	FHitResult FloorHit;
+	const bool bHasFloor = TraceTrackFloor(Location + Delta, HalfHeight, FloorHit);
+	bool bLanded = false;
+	if (!bTrackAirborne)
+	{
+		if (bHasFloor)
+		{
+			// Ramps and stairs are followed by snapping to the floor under the destination
+			Delta.Z = FloorHit.ImpactPoint.Z - BaseZ;
+		}
+		else
+		{
+			// Ran off the edge, fall from rest
+			bTrackAirborne = true;
+			TrackVerticalSpeed = 0.0f;
+		}
+	}
+	else if (bHasFloor && TrackVerticalSpeed <= 0.0f && BaseZ + Delta.Z <= FloorHit.ImpactPoint.Z)
+	{
+		Delta.Z = FloorHit.ImpactPoint.Z - BaseZ;
+		bLanded = true;
+	}
+
+	FHitResult Hit(1.0f);
+	SafeMoveUpdatedComponent(Delta, Rotation, true, Hit);
+	if (Hit.IsValidBlockingHit())
+	{
+		if (bTrackAirborne && TrackVerticalSpeed <= 0.0f && IsWalkable(Hit))
+		{
+			// Came down on top of something
+			FloorHit = Hit;
+			bLanded = true;
+		}
+		else
+		{
+			HandleImpact(Hit, DeltaTime, Delta);
+			SlideAlongSurface(Delta, 1.0f - Hit.Time, Hit.Normal, Hit, true);
+		}
+	}
+
+	if (!bJustTeleported)
+	{
+		Velocity = (UpdatedComponent->GetComponentLocation() - Location) / DeltaTime;
+	}
+	if (bLanded)
+	{
+		bTrackAirborne = false;
+		TrackVerticalSpeed = 0.0f;
+		Velocity.Z = 0.0f;
+		CharacterOwner->Landed(FloorHit);
+	}
+}
+
+bool URunnerMovementComponent::TraceTrackFloor(const FVector& CapsuleLocation, float HalfHeight, FHitResult& OutHit) const
+{
+	const FVector End = CapsuleLocation - FVector(0.0f, 0.0f, HalfHeight + MaxStepHeight);
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(RunnerTrackFloor), false, CharacterOwner);
+	FCollisionResponseParams ResponseParams;
+	UpdatedPrimitive->InitSweepCollisionParams(QueryParams, ResponseParams);
+	if (!GetWorld()->LineTraceSingleByChannel(OutHit, CapsuleLocation, End, UpdatedComponent->GetCollisionObjectType(), QueryParams, ResponseParams))
+	{
+		return false;
+	}
+	return IsWalkable(OutHit);
+}
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "RunnerLaneSystem.h"
+#include "RunnerMovementComponent.generated.h"
+
+/** Values of CustomMovementMode while MovementMode is MOVE_Custom */
+UENUM(BlueprintType)
+enum class ERunnerCustomMovementMode : uint8
+{
+	None	UMETA(Hidden),
+	Track	UMETA(DisplayName = "Track")
+};
+
+/**
+ * Character movement with a track-following mode for the runner. Once the runner stands on the
+ * track it runs forward along the control yaw, steers towards its lane and follows analytic jump
+ * arcs, at the cost of one floor line trace and one capsule sweep per update instead of the
+ * floor sweeps, step ups and ground velocity updates of walking.
+ */
+UCLASS(config=Game)
+class RUNNER_API URunnerMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	/** True while the track mode is driving the character */
+	bool IsOnTrack() const;
+
+	/** Lane the track mode steers towards; LateralSpeed is in cm/sec */
+	void SetLaneTarget(const FLaneFrame& Frame, float LateralOffset, float LateralSpeed);
+
+	/** Stops steering sideways, e.g. while the lane frame of a new heading is not known yet */
+	void ClearLaneTarget();
+
+	virtual bool IsFalling() const override;
+
+	virtual bool IsMovingOnGround() const override;
+
+	virtual float GetMaxSpeed() const override;
+
+	virtual bool DoJump(bool bReplayingMoves) override;
+
+protected:
+	virtual void OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode) override;
+
+	virtual void PhysWalking(float DeltaTime, int32 Iterations) override;
+
+	virtual void PhysCustom(float DeltaTime, int32 Iterations) override;
+
+	virtual void PhysicsRotation(float DeltaTime) override;
+
+	void PhysTrack(float DeltaTime, int32 Iterations);
+
+	/** Line trace for the walkable surface under a capsule at CapsuleLocation, within MaxStepHeight of its base */
+	bool TraceTrackFloor(const FVector& CapsuleLocation, float HalfHeight, FHitResult& OutHit) const;
+
+	/** Switches from walking to the track mode as soon as the character stands on a walkable floor */
+	UPROPERTY(EditAnywhere, Config, Category = "Character Movement: Track")
+	bool bUseTrackMovement = true;
+
+	/** Forward speed along the track, accelerates towards GetMaxSpeed */
+	float TrackSpeed = 0.0f;
+
+	/** Vertical speed of the current jump or fall arc */
+	float TrackVerticalSpeed = 0.0f;
+
+	bool bTrackAirborne = false;
+
+	FLaneFrame LaneFrame;
+
+	float TargetLateralOffset = 0.0f;
+
+	float LaneSpeed = 0.0f;
+
+	bool bHasLaneTarget = false;
+};
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerMovementState.h"
+#include "Runner.h"
+
+namespace RunnerMovementState
+{
+	constexpr uint8 Bit(ERunnerMovementState State)
+	{
+		return uint8(1 << uint8(State));
+	}
+
+	/** States each state may change to, indexed by ERunnerMovementState */
+	static const uint8 Transitions[] =
+	{
+		/* Run */	Bit(ERunnerMovementState::Jump) | Bit(ERunnerMovementState::Slide) | Bit(ERunnerMovementState::Turn) | Bit(ERunnerMovementState::Dead),
+		/* Jump */	Bit(ERunnerMovementState::Run) | Bit(ERunnerMovementState::Turn) | Bit(ERunnerMovementState::Dead),
+		/* Slide */	Bit(ERunnerMovementState::Run) | Bit(ERunnerMovementState::Dead),
+		/* Turn */	Bit(ERunnerMovementState::Run) | Bit(ERunnerMovementState::Jump) | Bit(ERunnerMovementState::Slide) | Bit(ERunnerMovementState::Turn) | Bit(ERunnerMovementState::Dead),
+		/* Dead */	0
+	};
+}
+
+bool FRunnerMovementStateMachine::CanEnter(ERunnerMovementState NewState) const
+{
+	return (RunnerMovementState::Transitions[uint8(State)] & RunnerMovementState::Bit(NewState)) != 0;
+}
+
+bool FRunnerMovementStateMachine::TryEnter(ERunnerMovementState NewState, float Now, float Duration)
+{
+	if (!CanEnter(NewState))
+	{
+		return false;
+	}
+	UE_LOG(LogRunner, Verbose, TEXT("Runner state %s -> %s"), *UEnum::GetValueAsString(State), *UEnum::GetValueAsString(NewState));
+	State = NewState;
+	EnterTime = Now;
+	ExitTime = Duration > 0.0f ? Now + Duration : -1.0f;
+	return true;
+}
+
+ERunnerMovementState FRunnerMovementStateMachine::Update(float Now)
+{
+	const ERunnerMovementState Current = State;
+	if (ExitTime >= 0.0f && Now >= ExitTime)
+	{
+		TryEnter(ERunnerMovementState::Run, Now);
+	}
+	return Current;
+}
+
+void FRunnerMovementStateMachine::Reset()
+{
+	State = ERunnerMovementState::Run;
+	EnterTime = 0.0f;
+	ExitTime = -1.0f;
+}
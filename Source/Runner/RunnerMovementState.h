@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RunnerMovementState.generated.h"
+
+UENUM(BlueprintType)
+enum class ERunnerMovementState : uint8
+{
+	Run		UMETA(DisplayName = "Run"),
+	Jump	UMETA(DisplayName = "Jump"),
+	Slide	UMETA(DisplayName = "Slide"),
+	Turn	UMETA(DisplayName = "Turn"),
+	Dead	UMETA(DisplayName = "Dead")
+};
+
+/**
+ * What the runner is doing, advanced on the simulation clock only. Animation follows the state
+ * instead of driving it, so skipped notifies or throttled animation cannot leave it stuck.
+ */
+class RUNNER_API FRunnerMovementStateMachine
+{
+public:
+	ERunnerMovementState GetState() const { return State; }
+
+	bool CanEnter(ERunnerMovementState NewState) const;
+
+	/**
+	 * Switches to NewState at Now if the current state allows it. A positive Duration makes the
+	 * state time out back to Run on the first Update at or after Now + Duration.
+	 */
+	bool TryEnter(ERunnerMovementState NewState, float Now, float Duration = 0.0f);
+
+	/** Ends a timed state that is due and returns the state from before the update */
+	ERunnerMovementState Update(float Now);
+
+	float GetTimeInState(float Now) const { return Now - EnterTime; }
+
+	void Reset();
+
+private:
+	ERunnerMovementState State = ERunnerMovementState::Run;
+
+	float EnterTime = 0.0f;
+
+	/** When a timed state ends, negative for states that last until something else ends them */
+	float ExitTime = -1.0f;
+};
@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerPreloadSubsystem.h"
+#include "Runner.h"
+#include "Engine/AssetManager.h"
+#include "HAL/PlatformMemory.h"
+
+void URunnerPreloadSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	StartTime = FPlatformTime::Seconds();
+	bManifestLoaded = false;
+
+	TArray<FSoftObjectPath> Assets;
+	for (const FSoftObjectPath& Asset : PreloadAssets)
+	{
+		if (Asset.IsValid())
+		{
+			Assets.Add(Asset);
+		}
+	}
+	if (Assets.Num() == 0)
+	{
+		OnManifestLoaded();
+		return;
+	}
+	ManifestHandle = RequestAsyncLoad(Assets, FStreamableManager::AsyncLoadHighPriority, FStreamableDelegate::CreateUObject(this, &URunnerPreloadSubsystem::OnManifestLoaded));
+	if (!ManifestHandle.IsValid())
+	{
+		OnManifestLoaded();
+	}
+}
+
+void URunnerPreloadSubsystem::Deinitialize()
+{
+	if (ManifestHandle.IsValid())
+	{
+		ManifestHandle->ReleaseHandle();
+		ManifestHandle.Reset();
+	}
+	PendingDelegates.Reset();
+	Super::Deinitialize();
+}
+
+void URunnerPreloadSubsystem::CallWhenManifestLoaded(FSimpleDelegate Delegate)
+{
+	if (bManifestLoaded)
+	{
+		Delegate.ExecuteIfBound();
+		return;
+	}
+	PendingDelegates.Add(MoveTemp(Delegate));
+}
+
+TSharedPtr<FStreamableHandle> URunnerPreloadSubsystem::RequestAsyncLoad(const TArray<FSoftObjectPath>& Assets, TAsyncLoadPriority Priority, FStreamableDelegate Delegate)
+{
+	return UAssetManager::GetStreamableManager().RequestAsyncLoad(Assets, MoveTemp(Delegate), Priority, true);
+}
+
+UObject* URunnerPreloadSubsystem::Resolve(const FSoftObjectPath& Asset)
+{
+	if (Asset.IsNull())
+	{
+		return nullptr;
+	}
+	if (UObject* Loaded = Asset.ResolveObject())
+	{
+		return Loaded;
+	}
+	UE_LOG(LogRunner, Warning, TEXT("%s was not preloaded, loading it synchronously"), *Asset.ToString());
+	return UAssetManager::GetStreamableManager().LoadSynchronous(Asset);
+}
+
+void URunnerPreloadSubsystem::OnManifestLoaded()
+{
+	bManifestLoaded = true;
+	const FPlatformMemoryStats Memory = FPlatformMemory::GetStats();
+	UE_LOG(LogRunner, Display, TEXT("Preloaded %d assets in %.2fs, %.2fs since launch; peak memory %llu MiB"),
+		PreloadAssets.Num(), FPlatformTime::Seconds() - StartTime, FPlatformTime::Seconds() - GStartTime, uint64(Memory.PeakUsedPhysical) / (1024 * 1024));
+
+	TArray<FSimpleDelegate> Delegates = MoveTemp(PendingDelegates);
+	for (FSimpleDelegate& Delegate : Delegates)
+	{
+		Delegate.ExecuteIfBound();
+	}
+}
@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Engine/StreamableManager.h"
+#include "RunnerPreloadSubsystem.generated.h"
+
+/**
+ * Streams the preload manifest in the background as soon as the game instance starts, instead of
+ * hard references pulling everything in synchronously when the map opens. Reports how long startup
+ * took and the memory high-water mark once the manifest is in.
+ */
+UCLASS(config=Game)
+class RUNNER_API URunnerPreloadSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	bool IsManifestLoaded() const { return bManifestLoaded; }
+
+	/** Runs the delegate once the manifest is loaded, straight away if it already is */
+	void CallWhenManifestLoaded(FSimpleDelegate Delegate);
+
+	/** Starts streaming assets outside the manifest; the handle keeps them loaded */
+	TSharedPtr<FStreamableHandle> RequestAsyncLoad(const TArray<FSoftObjectPath>& Assets, TAsyncLoadPriority Priority, FStreamableDelegate Delegate = FStreamableDelegate());
+
+	/**
+	 * Returns an asset that should already be resident. Anything missing from the manifest is
+	 * loaded synchronously, with a warning so it can be added.
+	 */
+	static UObject* Resolve(const FSoftObjectPath& Asset);
+
+protected:
+	void OnManifestLoaded();
+
+	/** Assets every run needs: the runner, its projectile and animations, the first enemies, the track tiles */
+	UPROPERTY(Config)
+	TArray<FSoftObjectPath> PreloadAssets;
+
+	TSharedPtr<FStreamableHandle> ManifestHandle;
+
+	TArray<FSimpleDelegate> PendingDelegates;
+
+	bool bManifestLoaded = false;
+
+	double StartTime = 0.0;
+};
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerSimulationSubsystem.h"
+#include "Runner.h"
+#include "EnemyManagerSubsystem.h"
+#include "Engine/World.h"
+
+float URunnerSimulationSubsystem::GetGameplayTime() const
+{
+	return bUseFixedStep ? float(NumSteps * double(GetStepSeconds())) : GetWorld()->GetTimeSeconds();
+}
+
+void URunnerSimulationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	if (!bUseFixedStep || StepRate <= 0.0f)
+	{
+		return;
+	}
+	SCOPE_CYCLE_COUNTER(STAT_RunnerFixedStep);
+	const float StepSeconds = GetStepSeconds();
+	Accumulator = FMath::Min(Accumulator + DeltaTime, StepSeconds * MaxStepsPerFrame);
+
+	UEnemyManagerSubsystem* EnemyManager = GetWorld()->GetSubsystem<UEnemyManagerSubsystem>();
+	while (Accumulator >= StepSeconds)
+	{
+		Accumulator -= StepSeconds;
+		NumSteps++;
+		OnFixedStep.Broadcast(StepSeconds);
+		if (EnemyManager != nullptr)
+		{
+			EnemyManager->StepEnemies(GetGameplayTime());
+		}
+	}
+	OnInterpolate.Broadcast(Accumulator / StepSeconds);
+}
+
+TStatId URunnerSimulationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URunnerSimulationSubsystem, STATGROUP_Tickables);
+}
+
+bool URunnerSimulationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
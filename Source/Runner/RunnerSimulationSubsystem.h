@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RunnerSimulationSubsystem.generated.h"
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FRunnerFixedStepDelegate, float /*StepSeconds*/);
+DECLARE_MULTICAST_DELEGATE_OneParam(FRunnerInterpolateDelegate, float /*Alpha*/);
+
+/**
+ * Runs gameplay at a fixed rate regardless of frame rate. Frame time is accumulated and spent in
+ * whole steps; the runner steps first, then the enemies. Visuals are interpolated between the last
+ * two steps so a lower render rate does not change how the game plays.
+ */
+UCLASS(config=Game)
+class RUNNER_API URunnerSimulationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	bool IsFixedStep() const { return bUseFixedStep; }
+
+	float GetStepSeconds() const { return 1.0f / StepRate; }
+
+	/** Simulated seconds in fixed-step mode, world time otherwise */
+	float GetGameplayTime() const;
+
+	/** Broadcast once per step, before the enemies are stepped */
+	FRunnerFixedStepDelegate OnFixedStep;
+
+	/** Broadcast once per frame after stepping, with how far the frame is into the next step */
+	FRunnerInterpolateDelegate OnInterpolate;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	UPROPERTY(Config)
+	bool bUseFixedStep = true;
+
+	/** Gameplay steps per second */
+	UPROPERTY(Config)
+	float StepRate = 60.0f;
+
+	/** Frame time beyond this many steps is dropped, so a hitch slows the game instead of snowballing */
+	UPROPERTY(Config)
+	int32 MaxStepsPerFrame = 5;
+
+	float Accumulator = 0.0f;
+
+	int64 NumSteps = 0;
+};
@@ -0,0 +1,249 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerTelemetry.h"
+#include "Runner.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/Paths.h"
+
+#if RUNNER_TELEMETRY_MMAP
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+const TCHAR* LexToString(ERunnerTelemetryEvent Event)
+{
+	switch (Event)
+	{
+	case ERunnerTelemetryEvent::Frame:			return TEXT("Frame");
+	case ERunnerTelemetryEvent::GameThread:		return TEXT("GameThread");
+	case ERunnerTelemetryEvent::LaneChange:		return TEXT("LaneChange");
+	case ERunnerTelemetryEvent::Slide:			return TEXT("Slide");
+	case ERunnerTelemetryEvent::ShieldOn:		return TEXT("ShieldOn");
+	case ERunnerTelemetryEvent::ShieldOff:		return TEXT("ShieldOff");
+	case ERunnerTelemetryEvent::Fire:			return TEXT("Fire");
+	case ERunnerTelemetryEvent::EnemyKilled:	return TEXT("EnemyKilled");
+	case ERunnerTelemetryEvent::TileSpawned:	return TEXT("TileSpawned");
+	default:									return TEXT("Unknown");
+	}
+}
+
+bool FRunnerTelemetryRing::Push(const FRunnerTelemetryRecord& Record)
+{
+	const uint32 CurrentHead = Head.load(std::memory_order_relaxed);
+	if (CurrentHead - Tail.load(std::memory_order_acquire) >= Capacity)
+	{
+		NumDropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	Records[CurrentHead & (Capacity - 1)] = Record;
+	Head.store(CurrentHead + 1, std::memory_order_release);
+	return true;
+}
+
+int32 FRunnerTelemetryRing::Pop(FRunnerTelemetryRecord* OutRecords, int32 MaxRecords)
+{
+	const uint32 CurrentTail = Tail.load(std::memory_order_relaxed);
+	const uint32 Available = Head.load(std::memory_order_acquire) - CurrentTail;
+	const uint32 Count = FMath::Min(Available, uint32(MaxRecords));
+
+	// Copy in at most two runs, either side of the wrap
+	const uint32 Start = CurrentTail & (Capacity - 1);
+	const uint32 FirstRun = FMath::Min(Count, Capacity - Start);
+	FMemory::Memcpy(OutRecords, Records + Start, FirstRun * sizeof(FRunnerTelemetryRecord));
+	FMemory::Memcpy(OutRecords + FirstRun, Records, (Count - FirstRun) * sizeof(FRunnerTelemetryRecord));
+	Tail.store(CurrentTail + Count, std::memory_order_release);
+	return int32(Count);
+}
+
+FRunnerTelemetryFileWriter::~FRunnerTelemetryFileWriter()
+{
+	Close();
+}
+
+#if RUNNER_TELEMETRY_MMAP
+
+bool FRunnerTelemetryFileWriter::Open(const FString& Path)
+{
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(Path), true);
+	const FString FullPath = IFileManager::Get().ConvertToAbsolutePathForExternalAppForWrite(*Path);
+	FileDescriptor = open(TCHAR_TO_UTF8(*FullPath), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (FileDescriptor < 0)
+	{
+		UE_LOG(LogRunner, Warning, TEXT("Could not open %s for telemetry, errno %d"), *FullPath, errno);
+		return false;
+	}
+	Size = 0;
+	MappedOffset = 0;
+	MappedUsed = 0;
+	return true;
+}
+
+bool FRunnerTelemetryFileWriter::MapNextChunk()
+{
+	if (Mapping != nullptr)
+	{
+		munmap(Mapping, ChunkSize);
+		Mapping = nullptr;
+		MappedOffset += ChunkSize;
+		MappedUsed = 0;
+	}
+	if (ftruncate(FileDescriptor, MappedOffset + ChunkSize) != 0)
+	{
+		UE_LOG(LogRunner, Warning, TEXT("Could not grow the telemetry file, errno %d"), errno);
+		return false;
+	}
+	void* Mapped = mmap(nullptr, ChunkSize, PROT_READ | PROT_WRITE, MAP_SHARED, FileDescriptor, MappedOffset);
+	if (Mapped == MAP_FAILED)
+	{
+		UE_LOG(LogRunner, Warning, TEXT("Could not map the telemetry file, errno %d"), errno);
+		return false;
+	}
+	Mapping = static_cast<uint8*>(Mapped);
+	return true;
+}
+
+bool FRunnerTelemetryFileWriter::Write(const void* Data, int64 NumBytes)
+{
+	if (FileDescriptor < 0)
+	{
+		return false;
+	}
+	const uint8* Bytes = static_cast<const uint8*>(Data);
+	while (NumBytes > 0)
+	{
+		if ((Mapping == nullptr || MappedUsed == ChunkSize) && !MapNextChunk())
+		{
+			return false;
+		}
+		const int64 Copy = FMath::Min(NumBytes, ChunkSize - MappedUsed);
+		FMemory::Memcpy(Mapping + MappedUsed, Bytes, Copy);
+		MappedUsed += Copy;
+		Size += Copy;
+		Bytes += Copy;
+		NumBytes -= Copy;
+	}
+	return true;
+}
+
+void FRunnerTelemetryFileWriter::Close()
+{
+	if (FileDescriptor < 0)
+	{
+		return;
+	}
+	if (Mapping != nullptr)
+	{
+		munmap(Mapping, ChunkSize);
+		Mapping = nullptr;
+	}
+	// The last window was mapped whole, cut off the part that was never written
+	if (ftruncate(FileDescriptor, Size) != 0)
+	{
+		UE_LOG(LogRunner, Warning, TEXT("Could not trim the telemetry file, errno %d"), errno);
+	}
+	close(FileDescriptor);
+	FileDescriptor = -1;
+}
+
+#else
+
+bool FRunnerTelemetryFileWriter::Open(const FString& Path)
+{
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(Path), true);
+	Handle = FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Path);
+	if (Handle == nullptr)
+	{
+		UE_LOG(LogRunner, Warning, TEXT("Could not open %s for telemetry"), *Path);
+		return false;
+	}
+	Size = 0;
+	return true;
+}
+
+bool FRunnerTelemetryFileWriter::Write(const void* Data, int64 NumBytes)
+{
+	if (Handle == nullptr || !Handle->Write(static_cast<const uint8*>(Data), NumBytes))
+	{
+		return false;
+	}
+	Size += NumBytes;
+	return true;
+}
+
+void FRunnerTelemetryFileWriter::Close()
+{
+	delete Handle;
+	Handle = nullptr;
+}
+
+#endif
+
+FRunnerTelemetrySession::~FRunnerTelemetrySession()
+{
+	Finish();
+}
+
+bool FRunnerTelemetrySession::Start(const FString& Path, float InDrainInterval)
+{
+	if (!Writer.Open(Path))
+	{
+		return false;
+	}
+	FRunnerTelemetryHeader Header;
+	Header.StartTicks = FDateTime::UtcNow().GetTicks();
+	Writer.Write(&Header, sizeof(Header));
+
+	Ring = MakeUnique<FRunnerTelemetryRing>();
+	DrainBuffer.SetNumUninitialized(FRunnerTelemetryRing::Capacity);
+	DrainInterval = InDrainInterval;
+	bStopping = false;
+	Thread = FRunnableThread::Create(this, TEXT("RunnerTelemetryDrain"), 0, TPri_BelowNormal);
+	return Thread != nullptr;
+}
+
+void FRunnerTelemetrySession::Finish()
+{
+	if (Thread != nullptr)
+	{
+		// Kill calls Stop and waits for Run to return, which drains the ring one last time
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+	Writer.Close();
+}
+
+uint32 FRunnerTelemetrySession::Run()
+{
+	while (!bStopping.load(std::memory_order_relaxed))
+	{
+		Drain();
+		FPlatformProcess::Sleep(DrainInterval);
+	}
+	Drain();
+	return 0;
+}
+
+void FRunnerTelemetrySession::Stop()
+{
+	bStopping = true;
+}
+
+void FRunnerTelemetrySession::Drain()
+{
+	for (;;)
+	{
+		const int32 Count = Ring->Pop(DrainBuffer.GetData(), DrainBuffer.Num());
+		if (Count == 0)
+		{
+			return;
+		}
+		Writer.Write(DrainBuffer.GetData(), int64(Count) * sizeof(FRunnerTelemetryRecord));
+	}
+}
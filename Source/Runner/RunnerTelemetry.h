@@ -0,0 +1,189 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include <atomic>
+
+/** Session dumps are written through mmap where the platform has it, buffered file writes elsewhere */
+#define RUNNER_TELEMETRY_MMAP (PLATFORM_UNIX || PLATFORM_ANDROID || PLATFORM_APPLE)
+
+class FRunnableThread;
+class IFileHandle;
+
+enum class ERunnerTelemetryEvent : uint8
+{
+	/** Value is the frame's delta time in ms */
+	Frame,
+	/** Value is the previous frame's game thread time in ms */
+	GameThread,
+	/** Value is the target lane */
+	LaneChange,
+	Slide,
+	ShieldOn,
+	ShieldOff,
+	Fire,
+	EnemyKilled,
+	/** Value is the track distance the tile starts at */
+	TileSpawned,
+	Num
+};
+
+const TCHAR* LexToString(ERunnerTelemetryEvent Event);
+
+/** One entry of a telemetry dump, written to disk as is */
+struct FRunnerTelemetryRecord
+{
+	/** World time in seconds */
+	float Time = 0.0f;
+
+	uint32 Frame = 0;
+
+	float Value = 0.0f;
+
+	ERunnerTelemetryEvent Event = ERunnerTelemetryEvent::Frame;
+
+	uint8 Padding[3] = {};
+};
+
+static_assert(sizeof(FRunnerTelemetryRecord) == 16, "Telemetry records are stored raw, keep them 16 bytes");
+
+/**
+ * File layout: this header, then FRunnerTelemetryRecord entries back to back until the end of the
+ * file. Records are in the order they were logged.
+ */
+struct FRunnerTelemetryHeader
+{
+	static constexpr uint32 ExpectedMagic = 0x4C544E52;	// "RNTL"
+
+	static constexpr uint32 ExpectedVersion = 1;
+
+	uint32 Magic = ExpectedMagic;
+
+	uint32 Version = ExpectedVersion;
+
+	uint32 RecordSize = sizeof(FRunnerTelemetryRecord);
+
+	uint32 Reserved = 0;
+
+	/** FDateTime ticks, UTC, of the start of the session */
+	int64 StartTicks = 0;
+};
+
+/**
+ * Fixed-size single-producer single-consumer ring. The game thread pushes and one drain thread
+ * pops; neither side locks or allocates, and records are dropped rather than blocking when full.
+ */
+class RUNNER_API FRunnerTelemetryRing
+{
+public:
+	static constexpr uint32 Capacity = 1 << 14;
+
+	/** Producer side, false if the record was dropped */
+	bool Push(const FRunnerTelemetryRecord& Record);
+
+	/** Consumer side, copies up to MaxRecords into OutRecords and returns how many */
+	int32 Pop(FRunnerTelemetryRecord* OutRecords, int32 MaxRecords);
+
+	uint32 GetNumDropped() const { return NumDropped.load(std::memory_order_relaxed); }
+
+private:
+	FRunnerTelemetryRecord Records[Capacity];
+
+	/** Next slot the producer writes, only advanced by the producer */
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> Head{ 0 };
+
+	/** Next slot the consumer reads, only advanced by the consumer */
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> Tail{ 0 };
+
+	std::atomic<uint32> NumDropped{ 0 };
+};
+
+/** Append-only file writer that copies into a memory-mapped window of the file */
+class RUNNER_API FRunnerTelemetryFileWriter
+{
+public:
+	~FRunnerTelemetryFileWriter();
+
+	bool Open(const FString& Path);
+
+	bool Write(const void* Data, int64 NumBytes);
+
+	/** Trims the file to what was written and closes it */
+	void Close();
+
+	int64 GetSize() const { return Size; }
+
+private:
+#if RUNNER_TELEMETRY_MMAP
+	/** Unmaps the current window and maps the next one, growing the file to cover it */
+	bool MapNextChunk();
+
+	static constexpr int64 ChunkSize = 1 << 20;
+
+	int FileDescriptor = -1;
+
+	uint8* Mapping = nullptr;
+
+	/** File offset of the current window */
+	int64 MappedOffset = 0;
+
+	int64 MappedUsed = 0;
+#else
+	IFileHandle* Handle = nullptr;
+#endif
+
+	int64 Size = 0;
+};
+
+/**
+ * One recording: the ring the game thread logs into and the thread that drains it to disk.
+ * Recording costs a few stores per event on the game thread; all file I/O happens on the drain thread.
+ */
+class RUNNER_API FRunnerTelemetrySession : public FRunnable
+{
+public:
+	virtual ~FRunnerTelemetrySession();
+
+	/** Opens the dump and starts the drain thread */
+	bool Start(const FString& Path, float InDrainInterval);
+
+	/** Game thread only */
+	void Record(ERunnerTelemetryEvent Event, float Time, uint32 Frame, float Value)
+	{
+		FRunnerTelemetryRecord Entry;
+		Entry.Time = Time;
+		Entry.Frame = Frame;
+		Entry.Value = Value;
+		Entry.Event = Event;
+		Ring->Push(Entry);
+	}
+
+	/** Drains what is left, closes the file and joins the thread */
+	void Finish();
+
+	uint32 GetNumDropped() const { return Ring ? Ring->GetNumDropped() : 0; }
+
+	int64 GetFileSize() const { return Writer.GetSize(); }
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	void Drain();
+
+	TUniquePtr<FRunnerTelemetryRing> Ring;
+
+	FRunnerTelemetryFileWriter Writer;
+
+	/** Drain thread's copy buffer, allocated once */
+	TArray<FRunnerTelemetryRecord> DrainBuffer;
+
+	FRunnableThread* Thread = nullptr;
+
+	float DrainInterval = 0.1f;
+
+	std::atomic<bool> bStopping{ false };
+};
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerTelemetryCommandlet.h"
+#include "Runner.h"
+#include "RunnerTelemetry.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+URunnerTelemetryCommandlet::URunnerTelemetryCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 URunnerTelemetryCommandlet::Main(const FString& Params)
+{
+	FString InputPath;
+	if (!FParse::Value(*Params, TEXT("Input="), InputPath))
+	{
+		UE_LOG(LogRunner, Error, TEXT("Usage: -run=RunnerTelemetry -Input=<dump.rtel> [-Output=<file.csv>]"));
+		return 1;
+	}
+	FString OutputPath = FPaths::ChangeExtension(InputPath, TEXT("csv"));
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *InputPath))
+	{
+		UE_LOG(LogRunner, Error, TEXT("Could not read %s"), *InputPath);
+		return 1;
+	}
+	FRunnerTelemetryHeader Header;
+	if (Bytes.Num() < int32(sizeof(Header)))
+	{
+		UE_LOG(LogRunner, Error, TEXT("%s is too short to be a telemetry dump"), *InputPath);
+		return 1;
+	}
+	FMemory::Memcpy(&Header, Bytes.GetData(), sizeof(Header));
+	if (Header.Magic != FRunnerTelemetryHeader::ExpectedMagic || Header.Version != FRunnerTelemetryHeader::ExpectedVersion || Header.RecordSize != sizeof(FRunnerTelemetryRecord))
+	{
+		UE_LOG(LogRunner, Error, TEXT("%s is not a version %u telemetry dump"), *InputPath, FRunnerTelemetryHeader::ExpectedVersion);
+		return 1;
+	}
+
+	const int32 NumRecords = (Bytes.Num() - int32(sizeof(Header))) / int32(sizeof(FRunnerTelemetryRecord));
+	const FRunnerTelemetryRecord* Records = reinterpret_cast<const FRunnerTelemetryRecord*>(Bytes.GetData() + sizeof(Header));
+	FString Csv = TEXT("Time,Frame,Event,Value\n");
+	Csv.Reserve(NumRecords * 32);
+	for (int32 Index = 0; Index < NumRecords; Index++)
+	{
+		FRunnerTelemetryRecord Record;
+		FMemory::Memcpy(&Record, Records + Index, sizeof(Record));
+		Csv += FString::Printf(TEXT("%.4f,%u,%s,%.4f\n"), Record.Time, Record.Frame, LexToString(Record.Event), Record.Value);
+	}
+	if (!FFileHelper::SaveStringToFile(Csv, *OutputPath))
+	{
+		UE_LOG(LogRunner, Error, TEXT("Could not write %s"), *OutputPath);
+		return 1;
+	}
+	UE_LOG(LogRunner, Display, TEXT("Wrote %d records from a session started %s to %s"), NumRecords, *FDateTime(Header.StartTicks).ToString(), *OutputPath);
+	return 0;
+}
@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "RunnerTelemetryCommandlet.generated.h"
+
+/**
+ * Converts a telemetry dump written by URunnerTelemetrySubsystem into CSV.
+ *
+ * UnrealEditor-Cmd Runner.uproject -run=RunnerTelemetry -Input=Saved/Telemetry/Session.rtel
+ *     [-Output=Saved/Telemetry/Session.csv]
+ */
+UCLASS()
+class URunnerTelemetryCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	URunnerTelemetryCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerTelemetrySubsystem.h"
+#include "Runner.h"
+#include "Engine/World.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Paths.h"
+
+void URunnerTelemetrySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	const bool bEnabled = FParse::Param(FCommandLine::Get(), TEXT("Telemetry")) || (bEnableTelemetry && !FParse::Param(FCommandLine::Get(), TEXT("NoTelemetry")));
+	if (!bEnabled)
+	{
+		return;
+	}
+
+	const FString Path = FPaths::ProjectSavedDir() / TEXT("Telemetry") / FString::Printf(TEXT("%s-%s.rtel"), *GetWorld()->GetMapName(), *FDateTime::Now().ToString());
+	Session = MakeUnique<FRunnerTelemetrySession>();
+	if (!Session->Start(Path, DrainInterval))
+	{
+		Session.Reset();
+		return;
+	}
+	UE_LOG(LogRunner, Log, TEXT("Recording telemetry to %s"), *Path);
+}
+
+void URunnerTelemetrySubsystem::Deinitialize()
+{
+	if (Session.IsValid())
+	{
+		Session->Finish();
+		UE_LOG(LogRunner, Log, TEXT("Telemetry session closed, %lld bytes, %u records dropped"), Session->GetFileSize(), Session->GetNumDropped());
+		Session.Reset();
+	}
+	Super::Deinitialize();
+}
+
+void URunnerTelemetrySubsystem::RecordEvent(const UObject* WorldContext, ERunnerTelemetryEvent Event, float Value)
+{
+	const UWorld* World = WorldContext ? WorldContext->GetWorld() : nullptr;
+	if (URunnerTelemetrySubsystem* Telemetry = World ? World->GetSubsystem<URunnerTelemetrySubsystem>() : nullptr)
+	{
+		Telemetry->Record(Event, Value);
+	}
+}
+
+void URunnerTelemetrySubsystem::Record(ERunnerTelemetryEvent Event, float Value)
+{
+	if (Session.IsValid())
+	{
+		Session->Record(Event, GetWorld()->GetTimeSeconds(), uint32(GFrameCounter), Value);
+	}
+}
+
+void URunnerTelemetrySubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	Record(ERunnerTelemetryEvent::Frame, DeltaTime * 1000.0f);
+	Record(ERunnerTelemetryEvent::GameThread, FPlatformTime::ToMilliseconds(GGameThreadTime));
+}
+
+TStatId URunnerTelemetrySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URunnerTelemetrySubsystem, STATGROUP_Tickables);
+}
+
+bool URunnerTelemetrySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RunnerTelemetry.h"
+#include "RunnerTelemetrySubsystem.generated.h"
+
+/**
+ * Records frame timings and gameplay events for the lifetime of a game world and dumps them to
+ * Saved/Telemetry/<Map>-<Time>.rtel. Turn dumps into CSV with -run=RunnerTelemetry.
+ */
+UCLASS(config=Game)
+class RUNNER_API URunnerTelemetrySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	/** Logs an event in the world's session, if it is recording */
+	static void RecordEvent(const UObject* WorldContext, ERunnerTelemetryEvent Event, float Value = 0.0f);
+
+	bool IsRecording() const { return Session.IsValid(); }
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void Record(ERunnerTelemetryEvent Event, float Value);
+
+	/** Record every session, not only those started with -Telemetry; -NoTelemetry turns it off regardless */
+	UPROPERTY(Config)
+	bool bEnableTelemetry = false;
+
+	/** Seconds the drain thread sleeps between emptying the ring */
+	UPROPERTY(Config)
+	float DrainInterval = 0.1f;
+
+	TUniquePtr<FRunnerTelemetrySession> Session;
+};
@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunnerVisualState.h"
+#include "Runner.h"
+#include "Components/PrimitiveComponent.h"
+
+void FRunnerVisualState::Set(UPrimitiveComponent* Component, ERunnerVisualState State, float Value)
+{
+	if (Component == nullptr)
+	{
+		return;
+	}
+	const int32 Index = static_cast<int32>(State);
+	const TArray<float>& Data = Component->GetCustomPrimitiveData().Data;
+	if (Data.IsValidIndex(Index) ? Data[Index] == Value : Value == 0.0f)
+	{
+		return;
+	}
+	Component->SetCustomPrimitiveDataFloat(Index, Value);
+}
+
+void FRunnerVisualState::Reset(UPrimitiveComponent* Component)
+{
+	if (Component == nullptr)
+	{
+		return;
+	}
+	for (int32 Index = 0; Index < static_cast<int32>(ERunnerVisualState::Num); Index++)
+	{
+		Set(Component, static_cast<ERunnerVisualState>(Index), 0.0f);
+	}
+}
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UPrimitiveComponent;
+
+/**
+ * Gameplay states shown by materials. Each value is the custom primitive data index the material
+ * reads it from, so materials set their scalar parameter to use custom primitive data at that index.
+ */
+enum class ERunnerVisualState : uint8
+{
+	/** Runner shield, 1 while active */
+	Shield = 0,
+	/** Enemy has spotted the runner */
+	Alerted = 1,
+	Num
+};
+
+/**
+ * Drives ERunnerVisualState through custom primitive data rather than dynamic material instances.
+ * A change only updates the primitive's uniform data, so cached mesh draw commands and instancing
+ * are kept and nothing is allocated.
+ */
+struct RUNNER_API FRunnerVisualState
+{
+	/** Sets one state on the component, doing nothing when it already has that value */
+	static void Set(UPrimitiveComponent* Component, ERunnerVisualState State, float Value);
+
+	/** Clears every state, for actors that are reused */
+	static void Reset(UPrimitiveComponent* Component);
+};
@@ -0,0 +1,230 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TrackCollisionSubsystem.h"
+#include "Runner.h"
+#include "Enemy.h"
+#include "ProjectilePoolSubsystem.h"
+#include "RunnerCharacter.h"
+#include "TrackGeneratorComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+
+void UTrackCollisionSubsystem::SetTrackGenerator(UTrackGeneratorComponent* Generator)
+{
+	TrackGenerator = Generator;
+}
+
+void UTrackCollisionSubsystem::AddTile(const FTrackTile& Tile)
+{
+	if (!bUseTrackCollision || Tile.Actor == nullptr || TileColliders.Contains(Tile.Actor))
+	{
+		return;
+	}
+	FTrackTileColliders& Registered = TileColliders.Add(Tile.Actor);
+	Tile.Actor->GetAttachedActors(AttachedScratch);
+	for (AActor* Attached : AttachedScratch)
+	{
+		if (AEnemy* Enemy = Cast<AEnemy>(Attached))
+		{
+			const int32 Slot = AddCollider(Enemy);
+			Registered.Slots.Add(Slot);
+			Registered.TargetHandles.Add(Targets.Add(MakeInterval(Tile, Enemy), Slot));
+			Enemy->UseTrackCollision();
+		}
+		else if (IsObstacleClass(Attached->GetClass()))
+		{
+			const int32 Slot = AddCollider(Attached);
+			Registered.Slots.Add(Slot);
+			Registered.ObstacleHandles.Add(Obstacles.Add(MakeInterval(Tile, Attached), Slot));
+		}
+	}
+}
+
+void UTrackCollisionSubsystem::RemoveTile(AActor* Tile)
+{
+	FTrackTileColliders Registered;
+	if (!TileColliders.RemoveAndCopyValue(Tile, Registered))
+	{
+		return;
+	}
+	for (const int32 Handle : Registered.ObstacleHandles)
+	{
+		Obstacles.Remove(Handle);
+	}
+	for (const int32 Handle : Registered.TargetHandles)
+	{
+		Targets.Remove(Handle);
+	}
+	for (const int32 Slot : Registered.Slots)
+	{
+		Colliders[Slot] = nullptr;
+		FreeColliders.Push(Slot);
+	}
+}
+
+void UTrackCollisionSubsystem::UpdateRunner(ARunnerCharacter* Runner)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RunnerTrackCollision);
+	TouchedScratch.Reset();
+	float Distance = 0.0f;
+	float Lateral = 0.0f;
+	const UTrackGeneratorComponent* Generator = TrackGenerator.Get();
+	if (Obstacles.Num() > 0 && Generator != nullptr && Generator->FindTrackLocation(Runner->GetActorLocation(), Distance, Lateral))
+	{
+		const UCapsuleComponent* Capsule = Runner->GetCapsuleComponent();
+		const float Reach = Capsule->GetScaledCapsuleRadius() + ContactSlop + QueryMargin;
+		QueryScratch.Reset();
+		Obstacles.Query(Distance - Reach, Distance + Reach, Lateral - Reach, Lateral + Reach, QueryScratch);
+		const FCollisionShape Shape = Capsule->GetCollisionShape(ContactSlop);
+		for (const int32 Slot : QueryScratch)
+		{
+			AActor* Obstacle = Colliders[Slot];
+			if (IsValid(Obstacle) && OverlapsActor(Obstacle, Capsule->GetComponentLocation(), Capsule->GetComponentQuat(), Shape, Capsule->GetCollisionObjectType()))
+			{
+				TouchedScratch.Add(Obstacle);
+			}
+		}
+	}
+
+	for (AActor* Obstacle : TouchedScratch)
+	{
+		if (!TouchedObstacles.Contains(Obstacle))
+		{
+			UE_LOG(LogRunner, Verbose, TEXT("Runner hit obstacle %s"), *Obstacle->GetName());
+			OnRunnerHitObstacle.Broadcast(Runner, Obstacle);
+		}
+	}
+	Swap(TouchedObstacles, TouchedScratch);
+}
+
+void UTrackCollisionSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	SCOPE_CYCLE_COUNTER(STAT_RunnerTrackCollision);
+	UpdateProjectiles(DeltaTime);
+}
+
+void UTrackCollisionSubsystem::UpdateProjectiles(float DeltaTime)
+{
+	const UTrackGeneratorComponent* Generator = TrackGenerator.Get();
+	UProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>();
+	if (Targets.Num() == 0 || Generator == nullptr || ProjectilePool == nullptr)
+	{
+		return;
+	}
+	ProjectilePool->GetActiveProjectiles(ProjectileScratch);
+	for (AActor* Projectile : ProjectileScratch)
+	{
+		const FVector End = Projectile->GetActorLocation();
+		const FVector Start = End - Projectile->GetVelocity() * DeltaTime;
+		float StartDistance = 0.0f;
+		float StartLateral = 0.0f;
+		float EndDistance = 0.0f;
+		float EndLateral = 0.0f;
+		if (!Generator->FindTrackLocation(Start, StartDistance, StartLateral) || !Generator->FindTrackLocation(End, EndDistance, EndLateral))
+		{
+			continue;
+		}
+
+		const UPrimitiveComponent* Root = Cast<UPrimitiveComponent>(Projectile->GetRootComponent());
+		const FCollisionShape Shape = Root ? Root->GetCollisionShape(ContactSlop) : FCollisionShape::MakeSphere(ContactSlop);
+		const float Reach = Shape.GetExtent().GetMax() + QueryMargin;
+		QueryScratch.Reset();
+		Targets.Query(FMath::Min(StartDistance, EndDistance) - Reach, FMath::Max(StartDistance, EndDistance) + Reach, FMath::Min(StartLateral, EndLateral) - Reach, FMath::Max(StartLateral, EndLateral) + Reach, QueryScratch);
+		for (const int32 Slot : QueryScratch)
+		{
+			AEnemy* Enemy = Cast<AEnemy>(Colliders[Slot]);
+			if (!IsValid(Enemy) || Enemy->IsDead() || Enemy == Projectile->GetOwner())
+			{
+				continue;
+			}
+			UPrimitiveComponent* Volume = Enemy->GetHitVolume();
+			FHitResult Hit;
+			const bool bHit = Start.Equals(End) ? Volume->OverlapComponent(End, FQuat::Identity, Shape) : Volume->SweepComponent(Hit, Start, End, FQuat::Identity, Shape);
+			if (bHit)
+			{
+				Enemy->HandleProjectileHit(Projectile);
+				ProjectilePool->Release(Projectile);
+				break;
+			}
+		}
+	}
+}
+
+TStatId UTrackCollisionSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTrackCollisionSubsystem, STATGROUP_Tickables);
+}
+
+bool UTrackCollisionSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+bool UTrackCollisionSubsystem::IsObstacleClass(const UClass* Class)
+{
+	if (const bool* Cached = ObstacleClassCache.Find(Class))
+	{
+		return *Cached;
+	}
+	bool bIsObstacle = false;
+	for (const UClass* Super = Class; Super != nullptr && !bIsObstacle; Super = Super->GetSuperClass())
+	{
+		bIsObstacle = ObstacleClasses.Contains(FSoftObjectPath(Super));
+	}
+	return ObstacleClassCache.Add(Class, bIsObstacle);
+}
+
+int32 UTrackCollisionSubsystem::AddCollider(AActor* Actor)
+{
+	if (FreeColliders.Num() > 0)
+	{
+		const int32 Slot = FreeColliders.Pop(false);
+		Colliders[Slot] = Actor;
+		return Slot;
+	}
+	return Colliders.Add(Actor);
+}
+
+FTrackInterval UTrackCollisionSubsystem::MakeInterval(const FTrackTile& Tile, const AActor* Actor)
+{
+	FVector Origin;
+	FVector Extent;
+	Actor->GetActorBounds(true, Origin, Extent, true);
+
+	FTrackInterval Interval;
+	Interval.StartDistance = TNumericLimits<float>::Max();
+	Interval.EndDistance = TNumericLimits<float>::Lowest();
+	Interval.MinLateral = TNumericLimits<float>::Max();
+	Interval.MaxLateral = TNumericLimits<float>::Lowest();
+	for (int32 Corner = 0; Corner < 8; Corner++)
+	{
+		const FVector Sign((Corner & 1) ? 1.0f : -1.0f, (Corner & 2) ? 1.0f : -1.0f, (Corner & 4) ? 1.0f : -1.0f);
+		const FVector Local = Tile.Start.InverseTransformPositionNoScale(Origin + Extent * Sign);
+		Interval.StartDistance = FMath::Min(Interval.StartDistance, Tile.StartDistance + float(Local.X));
+		Interval.EndDistance = FMath::Max(Interval.EndDistance, Tile.StartDistance + float(Local.X));
+		Interval.MinLateral = FMath::Min(Interval.MinLateral, float(Local.Y));
+		Interval.MaxLateral = FMath::Max(Interval.MaxLateral, float(Local.Y));
+	}
+	return Interval;
+}
+
+bool UTrackCollisionSubsystem::OverlapsActor(const AActor* Actor, const FVector& Location, const FQuat& Rotation, const FCollisionShape& Shape, ECollisionChannel ObjectType)
+{
+	TInlineComponentArray<UPrimitiveComponent*> Primitives(Actor);
+	for (UPrimitiveComponent* Primitive : Primitives)
+	{
+		// Trigger volumes such as door and laser zones overlap the runner without stopping it
+		if (!Primitive->IsQueryCollisionEnabled() || Primitive->GetCollisionResponseToChannel(ObjectType) != ECR_Block)
+		{
+			continue;
+		}
+		if (Primitive->OverlapComponent(Location, Rotation, Shape))
+		{
+			return true;
+		}
+	}
+	return false;
+}
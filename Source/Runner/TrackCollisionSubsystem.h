@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TrackObstacleRegistry.h"
+#include "TrackCollisionSubsystem.generated.h"
+
+class ARunnerCharacter;
+class UTrackGeneratorComponent;
+struct FTrackTile;
+
+DECLARE_MULTICAST_DELEGATE_TwoParams(FTrackObstacleHitDelegate, ARunnerCharacter*, AActor*);
+
+/** Colliders registered for one live tile */
+struct FTrackTileColliders
+{
+	TArray<int32> ObstacleHandles;
+
+	TArray<int32> TargetHandles;
+
+	/** Slots in UTrackCollisionSubsystem::Colliders */
+	TArray<int32> Slots;
+};
+
+/**
+ * Resolves runner-vs-obstacle and projectile-vs-enemy contacts on generated track. Obstacles and
+ * enemies are registered as track-space intervals when their tile is placed; only the candidates
+ * an interval test returns are checked against their collision shapes. Enemies registered here
+ * no longer listen for actor hits.
+ */
+UCLASS(config=Game)
+class RUNNER_API UTrackCollisionSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	bool IsEnabled() const { return bUseTrackCollision; }
+
+	/** Track the colliders live on, set by the generator when it starts */
+	void SetTrackGenerator(UTrackGeneratorComponent* Generator);
+
+	/** Registers the obstacles and enemies placed on a tile */
+	void AddTile(const FTrackTile& Tile);
+
+	void RemoveTile(AActor* Tile);
+
+	/** Tests the runner against nearby obstacles, called once per simulation step */
+	void UpdateRunner(ARunnerCharacter* Runner);
+
+	/** Obstacle intervals of the live tiles, for runners that are not actors */
+	const FTrackObstacleRegistry& GetObstacles() const { return Obstacles; }
+
+	/**
+	 * Whether the shape touches any component of the actor that blocks ObjectType, the same
+	 * components a blocking overlap test on that channel would report. Query-only triggers do not count.
+	 */
+	static bool OverlapsActor(const AActor* Actor, const FVector& Location, const FQuat& Rotation, const FCollisionShape& Shape, ECollisionChannel ObjectType);
+
+	/** Broadcast when the runner first touches an obstacle */
+	FTrackObstacleHitDelegate OnRunnerHitObstacle;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Projectiles against the enemies their path crosses since last frame */
+	void UpdateProjectiles(float DeltaTime);
+
+	bool IsObstacleClass(const UClass* Class);
+
+	int32 AddCollider(AActor* Actor);
+
+	/** Extent of the actor's colliding components in the tile's track space */
+	static FTrackInterval MakeInterval(const FTrackTile& Tile, const AActor* Actor);
+
+	/** Off: enemies keep their hit events and nothing is registered */
+	UPROPERTY(Config)
+	bool bUseTrackCollision = true;
+
+	/** Blueprints the runner has to avoid; subclasses count too */
+	UPROPERTY(Config)
+	TArray<FSoftObjectPath> ObstacleClasses;
+
+	/** Added around every query, covers tiles that bend and obstacles that move within their tile */
+	UPROPERTY(Config)
+	float QueryMargin = 50.0f;
+
+	/**
+	 * Added to the runner's capsule and projectile shapes. Movement stops both just short of what
+	 * they run into, so without it a runner pressed against an obstacle never touches it.
+	 */
+	UPROPERTY(Config)
+	float ContactSlop = 2.0f;
+
+	TMap<const UClass*, bool> ObstacleClassCache;
+
+	TWeakObjectPtr<UTrackGeneratorComponent> TrackGenerator;
+
+	FTrackObstacleRegistry Obstacles;
+
+	/** Enemies projectiles can hit */
+	FTrackObstacleRegistry Targets;
+
+	/** Actors behind the registry payloads */
+	UPROPERTY()
+	TArray<AActor*> Colliders;
+
+	TArray<int32> FreeColliders;
+
+	TMap<const AActor*, FTrackTileColliders> TileColliders;
+
+	/** Obstacles the runner was touching last step, so contact is only reported once */
+	TArray<AActor*> TouchedObstacles;
+
+	TArray<AActor*> TouchedScratch;
+
+	TArray<int32> QueryScratch;
+
+	TArray<AActor*> ProjectileScratch;
+
+	TArray<AActor*> AttachedScratch;
+};
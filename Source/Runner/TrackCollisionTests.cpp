@@ -0,0 +1,160 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TrackCollisionSubsystem.h"
+#include "Runner.h"
+#include "TrackObstacleRegistry.h"
+#include "Components/BoxComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTrackObstacleRegistryTest, "Runner.TrackCollision.Registry", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FTrackObstacleRegistryTest::RunTest(const FString& Parameters)
+{
+	FTrackObstacleRegistry Registry;
+	TArray<int32> Found;
+	auto Query = [&Registry, &Found](float MinDistance, float MaxDistance, float MinLateral, float MaxLateral)
+	{
+		Found.Reset();
+		Registry.Query(MinDistance, MaxDistance, MinLateral, MaxLateral, Found);
+		return Found;
+	};
+
+	FTrackInterval Short;
+	Short.StartDistance = 100.0f;
+	Short.EndDistance = 200.0f;
+	Short.MinLateral = -50.0f;
+	Short.MaxLateral = 50.0f;
+	const int32 ShortHandle = Registry.Add(Short, 1);
+
+	// Edges are inclusive on both axes
+	TestTrue(TEXT("Query ending on the start edge"), Query(0.0f, 100.0f, 0.0f, 0.0f) == TArray<int32>{ 1 });
+	TestTrue(TEXT("Query starting on the end edge"), Query(200.0f, 300.0f, 0.0f, 0.0f) == TArray<int32>{ 1 });
+	TestEqual(TEXT("Query just before the start"), Query(0.0f, 99.9f, 0.0f, 0.0f).Num(), 0);
+	TestEqual(TEXT("Query just past the end"), Query(200.1f, 300.0f, 0.0f, 0.0f).Num(), 0);
+	TestTrue(TEXT("Query on the right lateral edge"), Query(150.0f, 150.0f, 50.0f, 80.0f) == TArray<int32>{ 1 });
+	TestTrue(TEXT("Query on the left lateral edge"), Query(150.0f, 150.0f, -80.0f, -50.0f) == TArray<int32>{ 1 });
+	TestEqual(TEXT("Query right of the interval"), Query(150.0f, 150.0f, 50.1f, 80.0f).Num(), 0);
+	TestEqual(TEXT("Query left of the interval"), Query(150.0f, 150.0f, -80.0f, -50.1f).Num(), 0);
+	TestTrue(TEXT("Query inside the interval"), Query(140.0f, 160.0f, -10.0f, 10.0f) == TArray<int32>{ 1 });
+
+	// A long interval starting well before the query is still found
+	FTrackInterval Long;
+	Long.StartDistance = -1000.0f;
+	Long.EndDistance = 1000.0f;
+	Long.MinLateral = 100.0f;
+	Long.MaxLateral = 200.0f;
+	const int32 LongHandle = Registry.Add(Long, 2);
+	TestEqual(TEXT("Num after adding two"), Registry.Num(), 2);
+	TestTrue(TEXT("Query far along a long interval"), Query(900.0f, 950.0f, 150.0f, 150.0f) == TArray<int32>{ 2 });
+	TestEqual(TEXT("Query spanning both intervals"), Query(150.0f, 150.0f, 0.0f, 150.0f).Num(), 2);
+
+	Registry.Remove(ShortHandle);
+	TestEqual(TEXT("Num after removal"), Registry.Num(), 1);
+	TestTrue(TEXT("Removed interval is not found"), Query(150.0f, 150.0f, 0.0f, 150.0f) == TArray<int32>{ 2 });
+	Registry.Remove(ShortHandle);
+	TestEqual(TEXT("Removing twice is ignored"), Registry.Num(), 1);
+
+	Registry.Remove(LongHandle);
+	TestEqual(TEXT("Empty registry finds nothing"), Query(-10000.0f, 10000.0f, -10000.0f, 10000.0f).Num(), 0);
+
+	// Handles stay valid across inserts that land before them
+	FTrackInterval Later = Short;
+	Later.StartDistance = 500.0f;
+	Later.EndDistance = 600.0f;
+	const int32 LaterHandle = Registry.Add(Later, 3);
+	Registry.Add(Short, 4);
+	Registry.Remove(LaterHandle);
+	TestTrue(TEXT("Removal after an earlier insert"), Query(-10000.0f, 10000.0f, -10000.0f, 10000.0f) == TArray<int32>{ 4 });
+
+	Registry.Reset();
+	TestEqual(TEXT("Num after reset"), Registry.Num(), 0);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTrackCollisionOverlapTest, "Runner.TrackCollision.Overlap", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+namespace TrackCollisionTests
+{
+	AActor* SpawnBox(UWorld* World, const FVector& Location, ECollisionEnabled::Type Enabled, ECollisionResponse PawnResponse)
+	{
+		AActor* Actor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform(Location));
+		UBoxComponent* Box = NewObject<UBoxComponent>(Actor);
+		Box->SetBoxExtent(FVector(100.0f));
+		Box->SetCollisionObjectType(ECC_WorldStatic);
+		Box->SetCollisionResponseToAllChannels(ECR_Block);
+		Box->SetCollisionResponseToChannel(ECC_Pawn, PawnResponse);
+		Box->SetCollisionEnabled(Enabled);
+		Actor->SetRootComponent(Box);
+		Box->RegisterComponent();
+		Box->SetWorldLocation(Location);
+		return Actor;
+	}
+}
+
+bool FTrackCollisionOverlapTest::RunTest(const FString& Parameters)
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& Context = GEngine->CreateNewWorldContext(EWorldType::Game);
+	Context.SetCurrentWorld(World);
+
+	struct FCase
+	{
+		const TCHAR* Name;
+		ECollisionEnabled::Type Enabled;
+		ECollisionResponse PawnResponse;
+		bool bBlocks;
+	};
+	const FCase Cases[] =
+	{
+		{ TEXT("Blocking wall"), ECollisionEnabled::QueryAndPhysics, ECR_Block, true },
+		{ TEXT("Query-only blocker"), ECollisionEnabled::QueryOnly, ECR_Block, true },
+		{ TEXT("Trigger"), ECollisionEnabled::QueryOnly, ECR_Overlap, false },
+		{ TEXT("Physics-only body"), ECollisionEnabled::PhysicsOnly, ECR_Block, false },
+		{ TEXT("No collision"), ECollisionEnabled::NoCollision, ECR_Block, false },
+		{ TEXT("Ignores pawns"), ECollisionEnabled::QueryAndPhysics, ECR_Ignore, false },
+	};
+	// Far enough apart that a probe only ever reaches one of them
+	TArray<AActor*> Actors;
+	for (int32 Index = 0; Index < int32(UE_ARRAY_COUNT(Cases)); Index++)
+	{
+		Actors.Add(TrackCollisionTests::SpawnBox(World, FVector(1000.0f * Index, 0.0f, 0.0f), Cases[Index].Enabled, Cases[Index].PawnResponse));
+	}
+
+	const FCollisionShape Capsule = FCollisionShape::MakeCapsule(40.0f, 90.0f);
+	const FVector Probes[] = { FVector(0.0f), FVector(120.0f, 0.0f, 0.0f), FVector(0.0f, 0.0f, 170.0f), FVector(150.0f, 0.0f, 0.0f), FVector(0.0f, 0.0f, 200.0f) };
+	for (int32 Index = 0; Index < int32(UE_ARRAY_COUNT(Cases)); Index++)
+	{
+		const FCase& Case = Cases[Index];
+		for (int32 Probe = 0; Probe < int32(UE_ARRAY_COUNT(Probes)); Probe++)
+		{
+			const FVector Location = Actors[Index]->GetActorLocation() + Probes[Probe];
+			const bool bManual = UTrackCollisionSubsystem::OverlapsActor(Actors[Index], Location, FQuat::Identity, Capsule, ECC_Pawn);
+			const bool bSweep = World->OverlapBlockingTestByChannel(Location, FQuat::Identity, ECC_Pawn, Capsule);
+			TestTrue(FString::Printf(TEXT("%s, probe %d: manual overlap matches the engine"), Case.Name, Probe), bManual == bSweep);
+
+			// The first three probes reach into the box, the last two stay clear of it
+			const bool bExpected = Case.bBlocks && Probe < 3;
+			TestTrue(FString::Printf(TEXT("%s, probe %d: blocks as expected"), Case.Name, Probe), bManual == bExpected);
+		}
+	}
+
+	// Character movement stops the capsule just short of a wall, so a flush contact only counts
+	// once the shape is inflated by the subsystem's default ContactSlop
+	const float ContactSlop = 2.0f;
+	const FCollisionShape Inflated = FCollisionShape::MakeCapsule(40.0f + ContactSlop, 90.0f + ContactSlop);
+	const FVector Flush = Actors[0]->GetActorLocation() + FVector(100.0f + 40.0f + 0.5f, 0.0f, 0.0f);
+	TestFalse(TEXT("Capsule stopped short of the wall does not overlap it"), UTrackCollisionSubsystem::OverlapsActor(Actors[0], Flush, FQuat::Identity, Capsule, ECC_Pawn));
+	TestTrue(TEXT("Capsule stopped short of the wall touches it with contact slop"), UTrackCollisionSubsystem::OverlapsActor(Actors[0], Flush, FQuat::Identity, Inflated, ECC_Pawn));
+	TestTrue(TEXT("Inflated capsule matches the engine"), World->OverlapBlockingTestByChannel(Flush, FQuat::Identity, ECC_Pawn, Inflated));
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif
@@ -0,0 +1,329 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TrackGeneratorComponent.h"
+#include "Runner.h"
+#include "Enemy.h"
+#include "RunnerCharacter.h"
+#include "RunnerPreloadSubsystem.h"
+#include "TrackInstanceRenderer.h"
+#include "TrackCollisionSubsystem.h"
+#include "RunnerFrameBudgetSubsystem.h"
+#include "RunnerTelemetrySubsystem.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "Kismet/GameplayStatics.h"
+
+UTrackGeneratorComponent::UTrackGeneratorComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	InstanceRenderer = nullptr;
+}
+
+void UTrackGeneratorComponent::BeginPlay()
+{
+	Super::BeginPlay();
+	if (TileClasses.Num() == 0)
+	{
+		SetComponentTickEnabled(false);
+		return;
+	}
+	Random.Initialize(Seed);
+	LiveTiles.SetNum(TilesAhead);
+	Head = 0;
+	NumLive = 0;
+	NextTransform = StartTransform;
+	NextDistance = 0.0f;
+	UpcomingTiles.Reset();
+	TileClassHandles.Reset();
+	TileClassHandles.SetNum(TileClasses.Num());
+	QueueUpcomingTiles();
+	if (UTrackCollisionSubsystem* Collision = GetWorld()->GetSubsystem<UTrackCollisionSubsystem>())
+	{
+		Collision->SetTrackGenerator(this);
+	}
+	if (bInstanceTileMeshes)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Owner = GetOwner();
+		InstanceRenderer = GetWorld()->SpawnActor<ATrackInstanceRenderer>(SpawnParams);
+	}
+
+	// The runner needs ground right away, the rest of the window fills in over the next frames
+	SpawnNextTile();
+}
+
+void UTrackGeneratorComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	for (TSharedPtr<FStreamableHandle>& Handle : TileClassHandles)
+	{
+		if (Handle.IsValid())
+		{
+			Handle->CancelHandle();
+		}
+	}
+	TileClassHandles.Reset();
+	Super::EndPlay(EndPlayReason);
+}
+
+void UTrackGeneratorComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	SCOPE_CYCLE_COUNTER(STAT_RunnerTrackGeneratorTick);
+
+	ARunnerCharacter* Character = GetRunner();
+	if (Character != nullptr && NumLive == TilesAhead)
+	{
+		const FTrackTile& Oldest = LiveTiles[Head];
+		const FVector PastEnd = Character->GetActorLocation() - Oldest.End.GetLocation();
+		if (FVector::DotProduct(PastEnd, Oldest.End.GetUnitAxis(EAxis::X)) > RecycleDistance)
+		{
+			RecycleOldestTile();
+		}
+	}
+
+	for (int32 Spawned = 0; Spawned < MaxSpawnsPerFrame && NumLive < TilesAhead; Spawned++)
+	{
+		if (!SpawnNextTile())
+		{
+			break;
+		}
+	}
+	RUNNER_SET_COUNTER(RunnerTilesLive, NumLive);
+}
+
+bool UTrackGeneratorComponent::SpawnNextTile()
+{
+	const TSoftClassPtr<AActor>& TileClassPtr = TileClasses[UpcomingTiles[0]];
+	UClass* TileClass = TileClassPtr.Get();
+	if (TileClass == nullptr && !TileClassPtr.IsNull())
+	{
+		// Nothing to stand on yet, so the first tile cannot wait for streaming
+		if (NumLive > 0)
+		{
+			return false;
+		}
+		TileClass = Cast<UClass>(URunnerPreloadSubsystem::Resolve(TileClassPtr.ToSoftObjectPath()));
+	}
+	UpcomingTiles.RemoveAt(0, 1, false);
+	QueueUpcomingTiles();
+	if (TileClass == nullptr)
+	{
+		return true;
+	}
+	AActor* Tile = AcquireTile(TileClass);
+	if (Tile == nullptr)
+	{
+		return true;
+	}
+
+	// A tile heading somewhere new starts the next straight, so hand its lane frame to the runner
+	if (NumLive > 0)
+	{
+		const FTrackTile& Previous = LiveTiles[(Head + NumLive - 1) % LiveTiles.Num()];
+		const float Yaw = NextTransform.Rotator().Yaw;
+		ARunnerCharacter* Character = GetRunner();
+		if (Character != nullptr && !FMath::IsNearlyZero(FRotator::NormalizeAxis(Yaw - Previous.Start.Rotator().Yaw), 1.0f))
+		{
+			Character->GetLaneSystem().QueueSegmentFrame(Yaw, NextTransform.GetLocation());
+		}
+	}
+
+	if (InstanceRenderer != nullptr)
+	{
+		InstanceRenderer->AddTile(Tile);
+	}
+
+	FTrackTile& Slot = LiveTiles[(Head + NumLive) % LiveTiles.Num()];
+	Slot.Actor = Tile;
+	Slot.Start = NextTransform;
+	Slot.StartDistance = NextDistance;
+	Slot.End = FindTileEnd(Tile, Slot.Length);
+	NumLive++;
+	URunnerTelemetrySubsystem::RecordEvent(this, ERunnerTelemetryEvent::TileSpawned, Slot.StartDistance);
+	if (UTrackCollisionSubsystem* Collision = GetWorld()->GetSubsystem<UTrackCollisionSubsystem>())
+	{
+		Collision->AddTile(Slot);
+	}
+
+	NextTransform = Slot.End;
+	NextDistance += Slot.Length;
+	return true;
+}
+
+void UTrackGeneratorComponent::QueueUpcomingTiles()
+{
+	while (UpcomingTiles.Num() < TilesAhead)
+	{
+		const int32 ClassIndex = Random.RandRange(0, TileClasses.Num() - 1);
+		UpcomingTiles.Add(ClassIndex);
+		RequestTileClass(ClassIndex, UpcomingTiles.Num() == 1 ? FStreamableManager::AsyncLoadHighPriority : FStreamableManager::DefaultAsyncLoadPriority);
+	}
+}
+
+void UTrackGeneratorComponent::RequestTileClass(int32 ClassIndex, TAsyncLoadPriority Priority)
+{
+	if (TileClassHandles[ClassIndex].IsValid() || TileClasses[ClassIndex].IsNull())
+	{
+		return;
+	}
+	UGameInstance* GameInstance = GetWorld()->GetGameInstance();
+	URunnerPreloadSubsystem* Preload = GameInstance ? GameInstance->GetSubsystem<URunnerPreloadSubsystem>() : nullptr;
+	if (Preload == nullptr)
+	{
+		// No game instance to stream with (e.g. the benchmark commandlet), load it in place
+		URunnerPreloadSubsystem::Resolve(TileClasses[ClassIndex].ToSoftObjectPath());
+		return;
+	}
+	TileClassHandles[ClassIndex] = Preload->RequestAsyncLoad({ TileClasses[ClassIndex].ToSoftObjectPath() }, Priority);
+}
+
+void UTrackGeneratorComponent::RecycleOldestTile()
+{
+	FTrackTile& Oldest = LiveTiles[Head];
+	AActor* Tile = Oldest.Actor;
+	Oldest.Actor = nullptr;
+	Head = (Head + 1) % LiveTiles.Num();
+	NumLive--;
+	if (!IsValid(Tile))
+	{
+		return;
+	}
+
+	if (InstanceRenderer != nullptr)
+	{
+		InstanceRenderer->RemoveTile(Tile);
+	}
+	if (UTrackCollisionSubsystem* Collision = GetWorld()->GetSubsystem<UTrackCollisionSubsystem>())
+	{
+		Collision->RemoveTile(Tile);
+	}
+	Tile->SetActorHiddenInGame(true);
+	Tile->SetActorEnableCollision(false);
+	Tile->GetAttachedActors(AttachedScratch);
+	for (AActor* Attached : AttachedScratch)
+	{
+		Attached->SetActorHiddenInGame(true);
+		Attached->SetActorEnableCollision(false);
+	}
+	Pools.FindOrAdd(Tile->GetClass()).Free.Push(Tile);
+}
+
+AActor* UTrackGeneratorComponent::AcquireTile(UClass* TileClass)
+{
+	FTrackTilePool& Pool = Pools.FindOrAdd(TileClass);
+	while (Pool.Free.Num() > 0)
+	{
+		AActor* Tile = Pool.Free.Pop(false);
+		if (!IsValid(Tile))
+		{
+			continue;
+		}
+		Tile->SetActorTransform(NextTransform, false, nullptr, ETeleportType::ResetPhysics);
+		Tile->SetActorHiddenInGame(false);
+		Tile->SetActorEnableCollision(true);
+		ResetAttachedActors(Tile);
+		return Tile;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	return GetWorld()->SpawnActor<AActor>(TileClass, NextTransform, SpawnParams);
+}
+
+void UTrackGeneratorComponent::ResetAttachedActors(AActor* Tile)
+{
+	Tile->GetAttachedActors(AttachedScratch);
+	for (AActor* Attached : AttachedScratch)
+	{
+		AEnemy* Enemy = Cast<AEnemy>(Attached);
+		if (Enemy == nullptr)
+		{
+			Attached->SetActorHiddenInGame(false);
+			Attached->SetActorEnableCollision(true);
+			continue;
+		}
+		// Re-arming re-attaches the mesh and resets every collision channel; the tile is placed
+		// well ahead of the runner, so the enemy stays hidden until its turn comes
+		URunnerFrameBudgetSubsystem::Defer(Enemy, ERunnerWorkPriority::High, [Enemy]()
+		{
+			Enemy->SetActorHiddenInGame(false);
+			Enemy->SetActorEnableCollision(true);
+			Enemy->Start();
+		});
+	}
+}
+
+FTransform UTrackGeneratorComponent::FindTileEnd(AActor* Tile, float& OutLength) const
+{
+	TInlineComponentArray<USceneComponent*> SceneComponents(Tile);
+	for (const USceneComponent* Component : SceneComponents)
+	{
+		if (Component->GetFName() == AttachPointName)
+		{
+			const FTransform End(Component->GetComponentRotation(), Component->GetComponentLocation());
+			OutLength = FVector::Dist(NextTransform.GetLocation(), End.GetLocation());
+			return End;
+		}
+	}
+	OutLength = DefaultTileLength;
+	return FTransform(NextTransform.GetRotation(), NextTransform.GetLocation() + NextTransform.GetUnitAxis(EAxis::X) * DefaultTileLength);
+}
+
+bool UTrackGeneratorComponent::FindTrackLocation(const FVector& WorldLocation, float& OutDistance, float& OutLateral) const
+{
+	// The runner and its shots are near the newest tiles more often than the oldest
+	for (int32 Index = NumLive - 1; Index >= 0; Index--)
+	{
+		const FTrackTile& Tile = GetLiveTile(Index);
+		const FVector Local = Tile.Start.InverseTransformPositionNoScale(WorldLocation);
+		if (Local.X >= 0.0f && Local.X <= Tile.Length)
+		{
+			OutDistance = Tile.StartDistance + Local.X;
+			OutLateral = Local.Y;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool UTrackGeneratorComponent::FindWorldLocation(float Distance, float Lateral, FVector& OutLocation, float& OutYaw) const
+{
+	if (NumLive == 0)
+	{
+		return false;
+	}
+	// Live tiles are ordered by start distance from oldest to newest
+	int32 Low = 0;
+	int32 High = NumLive - 1;
+	while (Low < High)
+	{
+		const int32 Mid = (Low + High + 1) / 2;
+		if (GetLiveTile(Mid).StartDistance <= Distance)
+		{
+			Low = Mid;
+		}
+		else
+		{
+			High = Mid - 1;
+		}
+	}
+	const FTrackTile& Tile = GetLiveTile(Low);
+	const float Along = Distance - Tile.StartDistance;
+	if (Along < 0.0f || Along > Tile.Length)
+	{
+		return false;
+	}
+	OutLocation = Tile.Start.TransformPositionNoScale(FVector(Along, Lateral, 0.0f));
+	OutYaw = Tile.Start.Rotator().Yaw;
+	return true;
+}
+
+ARunnerCharacter* UTrackGeneratorComponent::GetRunner()
+{
+	if (!Runner.IsValid())
+	{
+		Runner = Cast<ARunnerCharacter>(UGameplayStatics::GetPlayerCharacter(this, 0));
+	}
+	return Runner.Get();
+}
@@ -0,0 +1,159 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/StreamableManager.h"
+#include "TrackGeneratorComponent.generated.h"
+
+class ARunnerCharacter;
+class ATrackInstanceRenderer;
+
+/** One tile currently placed on the track */
+USTRUCT()
+struct FTrackTile
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	AActor* Actor = nullptr;
+
+	FTransform Start;
+
+	FTransform End;
+
+	/** Distance along the track at which this tile begins */
+	float StartDistance = 0.0f;
+
+	float Length = 0.0f;
+};
+
+/** Recycled tiles of one class waiting to be placed again */
+USTRUCT()
+struct FTrackTilePool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<AActor*> Free;
+};
+
+/**
+ * Streams track tiles in front of the runner and recycles the ones it has passed.
+ * Only a fixed window of tiles is ever alive, and at most MaxSpawnsPerFrame are placed each frame.
+ */
+UCLASS(ClassGroup = (Runner), meta = (BlueprintSpawnableComponent))
+class RUNNER_API UTrackGeneratorComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UTrackGeneratorComponent();
+
+	/**
+	 * Tile blueprints to pick from, streamed in ahead of use; the generator stays idle when this is empty.
+	 * List them in the preload manifest too, so the first tile does not stall the map start.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Track")
+	TArray<TSoftClassPtr<AActor>> TileClasses;
+
+	/** Number of tiles kept alive around the runner */
+	UPROPERTY(EditDefaultsOnly, Category = "Track", meta = (ClampMin = "2"))
+	int32 TilesAhead = 8;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Track", meta = (ClampMin = "1"))
+	int32 MaxSpawnsPerFrame = 1;
+
+	/** How far past the end of a tile the runner has to be before it is recycled */
+	UPROPERTY(EditDefaultsOnly, Category = "Track")
+	float RecycleDistance = 500.0f;
+
+	/** Used for tiles that have no attach point component */
+	UPROPERTY(EditDefaultsOnly, Category = "Track")
+	float DefaultTileLength = 1000.0f;
+
+	/** Draw repeated tile meshes through ATrackInstanceRenderer instead of per-tile components */
+	UPROPERTY(EditDefaultsOnly, Category = "Track")
+	bool bInstanceTileMeshes = true;
+
+	/** Scene component marking where the next tile connects */
+	UPROPERTY(EditDefaultsOnly, Category = "Track")
+	FName AttachPointName = FName("AttachPoint");
+
+	UPROPERTY(EditDefaultsOnly, Category = "Track")
+	FTransform StartTransform;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Track")
+	int32 Seed = 0;
+
+	int32 GetNumLiveTiles() const { return NumLive; }
+
+	/**
+	 * Converts a world location to distance along the track and offset from the centre line,
+	 * measured in the frame of the live tile it falls on. False when it is on no live tile.
+	 */
+	bool FindTrackLocation(const FVector& WorldLocation, float& OutDistance, float& OutLateral) const;
+
+	/** Inverse of FindTrackLocation; false when the distance is on no live tile. Safe to call from worker threads. */
+	bool FindWorldLocation(float Distance, float Lateral, FVector& OutLocation, float& OutYaw) const;
+
+	/** Returns the live tile at the given age, 0 being the oldest */
+	const FTrackTile& GetLiveTile(int32 Index) const { return LiveTiles[(Head + Index) % LiveTiles.Num()]; }
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Places the next queued tile, false while its class is still streaming in */
+	bool SpawnNextTile();
+
+	/** Tops the queue of upcoming picks back up and starts loading the classes they need */
+	void QueueUpcomingTiles();
+
+	void RequestTileClass(int32 ClassIndex, TAsyncLoadPriority Priority);
+
+	void RecycleOldestTile();
+
+	AActor* AcquireTile(UClass* TileClass);
+
+	void ResetAttachedActors(AActor* Tile);
+
+	FTransform FindTileEnd(AActor* Tile, float& OutLength) const;
+
+	ARunnerCharacter* GetRunner();
+
+	/** Ring of live tiles, oldest at Head */
+	UPROPERTY()
+	TArray<FTrackTile> LiveTiles;
+
+	int32 Head = 0;
+
+	int32 NumLive = 0;
+
+	UPROPERTY()
+	TMap<UClass*, FTrackTilePool> Pools;
+
+	FTransform NextTransform;
+
+	float NextDistance = 0.0f;
+
+	FRandomStream Random;
+
+	/** Indices into TileClasses picked ahead of time so their classes can load before they are placed */
+	TArray<int32> UpcomingTiles;
+
+	/** Streaming handle per entry of TileClasses, keeps the class loaded once requested */
+	TArray<TSharedPtr<FStreamableHandle>> TileClassHandles;
+
+	TWeakObjectPtr<ARunnerCharacter> Runner;
+
+	UPROPERTY()
+	ATrackInstanceRenderer* InstanceRenderer;
+
+	/** Scratch buffer reused when walking a tile's attached actors */
+	TArray<AActor*> AttachedScratch;
+};
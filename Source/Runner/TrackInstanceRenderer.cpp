@@ -0,0 +1,222 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TrackInstanceRenderer.h"
+#include "Runner.h"
+#include "Enemy.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+
+ATrackInstanceRenderer::ATrackInstanceRenderer()
+{
+	// Ticks only on frames where tiles came or went, after the generator has placed them
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+	RootComponent = CreateDefaultSubobject<USceneComponent>(FName("Root"));
+}
+
+void ATrackInstanceRenderer::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Tiles.Reset();
+	Super::EndPlay(EndPlayReason);
+}
+
+void ATrackInstanceRenderer::AddTile(AActor* Tile)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RunnerTrackInstancing);
+	FTrackTileInstances& Instances = FindOrAddTile(Tile);
+	if (!Instances.bOnTrack)
+	{
+		Instances.bOnTrack = true;
+		MarkBatchesDirty(Instances);
+	}
+}
+
+void ATrackInstanceRenderer::RemoveTile(AActor* Tile)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RunnerTrackInstancing);
+	FTrackTileInstances* Instances = Tiles.Find(Tile);
+	if (Instances != nullptr && Instances->bOnTrack)
+	{
+		Instances->bOnTrack = false;
+		MarkBatchesDirty(*Instances);
+	}
+}
+
+void ATrackInstanceRenderer::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+	FlushDirtyBatches();
+}
+
+void ATrackInstanceRenderer::MarkBatchesDirty(const FTrackTileInstances& Instances)
+{
+	if (Instances.Batches.Num() == 0)
+	{
+		return;
+	}
+	DirtyBatches.SetNum(Batches.Num(), false);
+	for (const int32 BatchIndex : Instances.Batches)
+	{
+		DirtyBatches[BatchIndex] = true;
+	}
+	SetActorTickEnabled(true);
+}
+
+void ATrackInstanceRenderer::FlushDirtyBatches()
+{
+	SCOPE_CYCLE_COUNTER(STAT_RunnerTrackInstancing);
+	SetActorTickEnabled(false);
+	if (DirtyBatches.Find(true) == INDEX_NONE)
+	{
+		return;
+	}
+
+	for (const TPair<AActor*, FTrackTileInstances>& Pair : Tiles)
+	{
+		const FTrackTileInstances& Instances = Pair.Value;
+		if (!Instances.bOnTrack)
+		{
+			continue;
+		}
+		for (int32 Index = 0; Index < Instances.Components.Num(); Index++)
+		{
+			const UStaticMeshComponent* Component = Instances.Components[Index];
+			if (IsValid(Component) && DirtyBatches[Instances.Batches[Index]])
+			{
+				Batches[Instances.Batches[Index]].Transforms.Add(Component->GetComponentTransform());
+			}
+		}
+	}
+
+	for (TConstSetBitIterator<> It(DirtyBatches); It; ++It)
+	{
+		FTrackInstanceBatch& Batch = Batches[It.GetIndex()];
+		UHierarchicalInstancedStaticMeshComponent* Component = Batch.Component;
+		const int32 NumBefore = Component->GetInstanceCount();
+		const int32 NumAfter = Batch.Transforms.Num();
+		NumInstances += NumAfter - NumBefore;
+
+		// Existing instances are overwritten in place and only the tail grows or shrinks, so no
+		// removal ever swaps an instance into a hole
+		if (NumAfter < NumBefore)
+		{
+			RemovedScratch.Reset();
+			for (int32 Instance = NumBefore - 1; Instance >= NumAfter; Instance--)
+			{
+				RemovedScratch.Add(Instance);
+			}
+			Component->RemoveInstances(RemovedScratch);
+		}
+		AddedScratch.Reset();
+		if (NumAfter > NumBefore)
+		{
+			AddedScratch.Append(Batch.Transforms.GetData() + NumBefore, NumAfter - NumBefore);
+			Batch.Transforms.SetNum(NumBefore, false);
+		}
+		if (Batch.Transforms.Num() > 0)
+		{
+			Component->BatchUpdateInstancesTransforms(0, Batch.Transforms, true, false, true);
+		}
+		if (AddedScratch.Num() > 0)
+		{
+			Component->AddInstances(AddedScratch, false, true);
+		}
+		Component->MarkRenderStateDirty();
+		Batch.Transforms.Reset();
+	}
+	DirtyBatches.Init(false, Batches.Num());
+	RUNNER_SET_COUNTER(RunnerTrackInstances, NumInstances);
+}
+
+FTrackTileInstances& ATrackInstanceRenderer::FindOrAddTile(AActor* Tile)
+{
+	if (FTrackTileInstances* Existing = Tiles.Find(Tile))
+	{
+		return *Existing;
+	}
+
+	FTrackTileInstances& Instances = Tiles.Add(Tile);
+	GatherComponents(Tile, Instances);
+
+	// Pieces placed as their own actors on the tile are batched too, enemies keep animating themselves
+	Tile->GetAttachedActors(AttachedScratch);
+	for (AActor* Attached : AttachedScratch)
+	{
+		if (!Attached->IsA<AEnemy>())
+		{
+			GatherComponents(Attached, Instances);
+		}
+	}
+	return Instances;
+}
+
+void ATrackInstanceRenderer::GatherComponents(AActor* Actor, FTrackTileInstances& Instances)
+{
+	Actor->GetComponents<UStaticMeshComponent>(ComponentScratch);
+	for (UStaticMeshComponent* Component : ComponentScratch)
+	{
+		// Instanced components are already batched by their owner
+		if (Component->IsA<UInstancedStaticMeshComponent>() || !Component->IsVisible() || Component->bHiddenInGame)
+		{
+			continue;
+		}
+		const int32 BatchIndex = FindOrAddBatch(Component);
+		if (BatchIndex == INDEX_NONE)
+		{
+			continue;
+		}
+		Component->SetHiddenInGame(true);
+		Instances.Components.Add(Component);
+		Instances.Batches.Add(BatchIndex);
+	}
+}
+
+int32 ATrackInstanceRenderer::FindOrAddBatch(const UStaticMeshComponent* Component)
+{
+	UStaticMesh* Mesh = Component->GetStaticMesh();
+	if (Mesh == nullptr || !IsInstancedMesh(Mesh))
+	{
+		return INDEX_NONE;
+	}
+
+	FTrackInstanceKey Key;
+	Key.Mesh = Mesh;
+	for (int32 Index = 0; Index < Component->GetNumMaterials(); Index++)
+	{
+		Key.Materials.Add(Component->GetMaterial(Index));
+	}
+	if (const int32* Existing = BatchLookup.Find(Key))
+	{
+		return *Existing;
+	}
+
+	UHierarchicalInstancedStaticMeshComponent* Instanced = NewObject<UHierarchicalInstancedStaticMeshComponent>(this);
+	Instanced->SetupAttachment(RootComponent);
+	Instanced->SetMobility(EComponentMobility::Movable);
+	Instanced->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Instanced->SetCanEverAffectNavigation(false);
+	Instanced->SetCastShadow(Component->CastShadow);
+	Instanced->SetStaticMesh(Mesh);
+	for (int32 Index = 0; Index < Key.Materials.Num(); Index++)
+	{
+		Instanced->SetMaterial(Index, Key.Materials[Index]);
+	}
+	Instanced->RegisterComponent();
+
+	FTrackInstanceBatch& Batch = Batches.AddDefaulted_GetRef();
+	Batch.Component = Instanced;
+	UE_LOG(LogRunner, Log, TEXT("Instancing track mesh %s"), *Mesh->GetName());
+	return BatchLookup.Add(Key, Batches.Num() - 1);
+}
+
+bool ATrackInstanceRenderer::IsInstancedMesh(const UStaticMesh* Mesh)
+{
+	if (const bool* Cached = InstancedMeshCache.Find(Mesh))
+	{
+		return *Cached;
+	}
+	return InstancedMeshCache.Add(Mesh, InstancedMeshes.Contains(FSoftObjectPath(Mesh)));
+}
@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "TrackInstanceRenderer.generated.h"
+
+class UHierarchicalInstancedStaticMeshComponent;
+class UMaterialInterface;
+class UStaticMesh;
+class UStaticMeshComponent;
+
+/** Mesh and materials shared by every instance in one batch */
+struct FTrackInstanceKey
+{
+	const UStaticMesh* Mesh = nullptr;
+
+	TArray<UMaterialInterface*, TInlineAllocator<4>> Materials;
+
+	bool operator==(const FTrackInstanceKey& Other) const
+	{
+		return Mesh == Other.Mesh && Materials == Other.Materials;
+	}
+
+	friend uint32 GetTypeHash(const FTrackInstanceKey& Key)
+	{
+		uint32 Hash = GetTypeHash(Key.Mesh);
+		for (const UMaterialInterface* Material : Key.Materials)
+		{
+			Hash = HashCombine(Hash, GetTypeHash(Material));
+		}
+		return Hash;
+	}
+};
+
+/** One instanced component, holding exactly the instances of the tiles on the track */
+USTRUCT()
+struct FTrackInstanceBatch
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UHierarchicalInstancedStaticMeshComponent* Component = nullptr;
+
+	/** Scratch for the live transforms gathered when the batch is refreshed */
+	TArray<FTransform> Transforms;
+};
+
+/** Meshes of one tile that are drawn through batches instead of their own components */
+USTRUCT()
+struct FTrackTileInstances
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<UStaticMeshComponent*> Components;
+
+	TArray<int32> Batches;
+
+	bool bOnTrack = false;
+};
+
+/**
+ * Draws the repeated meshes of live track tiles as instances of one hierarchical instanced
+ * component per mesh, so a long run costs one draw call per mesh instead of one per piece.
+ * The tile's own components keep their collision but are hidden. Tiles coming and going only
+ * mark their batches dirty; each dirty batch is rewritten once at the end of the frame, so no
+ * instance of a recycled tile is left behind in the buffers or the bounds.
+ */
+UCLASS(config=Game)
+class RUNNER_API ATrackInstanceRenderer : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ATrackInstanceRenderer();
+
+	/** Takes over the listed meshes of a tile that was just placed */
+	void AddTile(AActor* Tile);
+
+	/** Drops the instances of a tile leaving the track */
+	void RemoveTile(AActor* Tile);
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	int32 GetNumBatches() const { return Batches.Num(); }
+
+	int32 GetNumInstances() const { return NumInstances; }
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Finds the instanceable meshes of a tile the first time it is placed */
+	FTrackTileInstances& FindOrAddTile(AActor* Tile);
+
+	void GatherComponents(AActor* Actor, FTrackTileInstances& Instances);
+
+	/** Batch the component's mesh and materials draw into, INDEX_NONE if it is not instanced */
+	int32 FindOrAddBatch(const UStaticMeshComponent* Component);
+
+	bool IsInstancedMesh(const UStaticMesh* Mesh);
+
+	void MarkBatchesDirty(const FTrackTileInstances& Instances);
+
+	/** Rewrites every dirty batch from the tiles on the track, with one render state update each */
+	void FlushDirtyBatches();
+
+	/** Meshes to instance; anything else, such as animated doors, keeps its own component */
+	UPROPERTY(Config)
+	TArray<FSoftObjectPath> InstancedMeshes;
+
+	/** Whether each mesh seen so far is in InstancedMeshes */
+	TMap<const UStaticMesh*, bool> InstancedMeshCache;
+
+	UPROPERTY()
+	TArray<FTrackInstanceBatch> Batches;
+
+	TMap<FTrackInstanceKey, int32> BatchLookup;
+
+	UPROPERTY()
+	TMap<AActor*, FTrackTileInstances> Tiles;
+
+	/** Batches touched since they were last rewritten */
+	TBitArray<> DirtyBatches;
+
+	int32 NumInstances = 0;
+
+	/** Scratch buffers reused while gathering a tile's meshes */
+	TArray<AActor*> AttachedScratch;
+
+	TArray<UStaticMeshComponent*> ComponentScratch;
+
+	TArray<int32> RemovedScratch;
+
+	TArray<FTransform> AddedScratch;
+};
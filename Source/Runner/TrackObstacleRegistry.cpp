@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TrackObstacleRegistry.h"
+#include "Runner.h"
+#include "Algo/BinarySearch.h"
+
+int32 FTrackObstacleRegistry::Add(const FTrackInterval& Interval, int32 Payload)
+{
+	// Tiles are placed in track order, so this is almost always an append
+	const int32 Index = Algo::UpperBound(Starts, Interval.StartDistance);
+	Starts.Insert(Interval.StartDistance, Index);
+	Ends.Insert(Interval.EndDistance, Index);
+	MinLaterals.Insert(Interval.MinLateral, Index);
+	MaxLaterals.Insert(Interval.MaxLateral, Index);
+	Payloads.Insert(Payload, Index);
+	Handles.Insert(NextHandle, Index);
+	MaxLength = FMath::Max(MaxLength, Interval.EndDistance - Interval.StartDistance);
+	return NextHandle++;
+}
+
+void FTrackObstacleRegistry::Remove(int32 Handle)
+{
+	const int32 Index = Handles.Find(Handle);
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+	Starts.RemoveAt(Index, 1, false);
+	Ends.RemoveAt(Index, 1, false);
+	MinLaterals.RemoveAt(Index, 1, false);
+	MaxLaterals.RemoveAt(Index, 1, false);
+	Payloads.RemoveAt(Index, 1, false);
+	Handles.RemoveAt(Index, 1, false);
+	if (Starts.Num() == 0)
+	{
+		MaxLength = 0.0f;
+	}
+}
+
+void FTrackObstacleRegistry::Query(float MinDistance, float MaxDistance, float MinLateral, float MaxLateral, TArray<int32>& OutPayloads) const
+{
+	// Nothing starting before this can reach MinDistance
+	for (int32 Index = Algo::LowerBound(Starts, MinDistance - MaxLength); Index < Starts.Num() && Starts[Index] <= MaxDistance; Index++)
+	{
+		if (Ends[Index] >= MinDistance && MaxLaterals[Index] >= MinLateral && MinLaterals[Index] <= MaxLateral)
+		{
+			OutPayloads.Add(Payloads[Index]);
+		}
+	}
+}
+
+void FTrackObstacleRegistry::Reset()
+{
+	Starts.Reset();
+	Ends.Reset();
+	MinLaterals.Reset();
+	MaxLaterals.Reset();
+	Payloads.Reset();
+	Handles.Reset();
+	MaxLength = 0.0f;
+}
@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Footprint of something on the track: a span of track distance by a span of lateral offset */
+struct FTrackInterval
+{
+	float StartDistance = 0.0f;
+
+	float EndDistance = 0.0f;
+
+	float MinLateral = 0.0f;
+
+	float MaxLateral = 0.0f;
+};
+
+/**
+ * Intervals in track space kept sorted by start distance, so the handful that can touch a point
+ * or a short segment are found with a binary search and a 2D overlap test.
+ * Knows nothing about actors; each interval carries an integer payload chosen by the caller.
+ */
+class RUNNER_API FTrackObstacleRegistry
+{
+public:
+	/** Adds an interval and returns a handle for removing it */
+	int32 Add(const FTrackInterval& Interval, int32 Payload);
+
+	void Remove(int32 Handle);
+
+	/** Appends the payload of every interval overlapping the query rectangle */
+	void Query(float MinDistance, float MaxDistance, float MinLateral, float MaxLateral, TArray<int32>& OutPayloads) const;
+
+	int32 Num() const { return Starts.Num(); }
+
+	void Reset();
+
+private:
+	/** Sorted ascending, the other arrays follow the same order */
+	TArray<float> Starts;
+
+	TArray<float> Ends;
+
+	TArray<float> MinLaterals;
+
+	TArray<float> MaxLaterals;
+
+	TArray<int32> Payloads;
+
+	TArray<int32> Handles;
+
+	int32 NextHandle = 0;
+
+	/** Longest interval added, bounds how far back a query has to look */
+	float MaxLength = 0.0f;
+};